@@ -0,0 +1,56 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// affinity.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__AFFINITY__H
+#define __CENTRIFUGEPP__AFFINITY__H
+
+
+#if defined( __linux__ )
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+
+namespace as {
+
+	/// pins the calling thread to cpu, false where that is not supported or is refused
+	inline bool pinThread( int cpu )
+	{
+#if defined( __linux__ )
+		cpu_set_t set;
+		CPU_ZERO( &set );
+		CPU_SET( cpu, &set );
+
+		return 0 == pthread_setaffinity_np( pthread_self(), sizeof set, &set );
+#else
+		return false;
+#endif
+	}
+
+} // namespace as
+
+
+#endif
@@ -0,0 +1,327 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// bufferPool.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__BUFFER_POOL__H
+#define __CENTRIFUGEPP__BUFFER_POOL__H
+
+
+#include <new>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <string_view>
+
+#include "core.hpp"
+
+
+namespace as {
+
+	class SharedBuffer;
+
+
+	/// buffers in a few size classes, carved out of 256 KiB slabs; larger ones come from the heap
+	///
+	/// one owner thread takes buffers, any thread may release them: a released buffer is pushed to a lock-free list
+	/// of its class, the owner takes the whole list at once when its own one runs dry. Slabs are kept until the pool
+	/// goes, which is once the owner has closed it and every buffer is released
+	class BufferPool {
+	public:
+		struct alignas( 16 ) t_block {
+			std::atomic_uint32_t refs{ 1 };
+			uint32_t sizeClass = 0;
+			BufferPool * pool = nullptr;
+			t_block * next = nullptr;
+
+			t_byte * Data()
+			{
+				return reinterpret_cast<t_byte *>( this + 1 );
+			}
+		};
+
+	protected:
+		static constexpr size_t CacheLineSize = 64;
+		static constexpr size_t ClassCount = 5;
+		static constexpr size_t MinClassBytes = 128;
+		static constexpr size_t SlabBytes = 256 * 1024;
+		static constexpr uint32_t Unpooled = ~uint32_t( 0 );
+
+		struct t_class {
+			/// owner thread
+			t_block * local = nullptr;
+			/// released by any thread
+			alignas( CacheLineSize ) std::atomic<t_block *> released{ nullptr };
+		};
+
+	protected:
+		std::array<t_class, ClassCount> m_classes;
+		std::vector<std::unique_ptr<t_byte[]>> m_slabs;
+		/// the owner and every buffer handed out
+		std::atomic_size_t m_refs{ 1 };
+
+	protected:
+		BufferPool() = default;
+
+
+		/// 128 B, 512 B, 2 KiB, 8 KiB, 32 KiB
+		static size_t classBytes( size_t c )
+		{
+			return MinClassBytes << ( 2 * c );
+		}
+
+
+		void carve( size_t c )
+		{
+			auto stride = sizeof( t_block ) + classBytes( c );
+			auto count = SlabBytes / stride;
+			auto slab = m_slabs.emplace_back( new t_byte[stride * count] ).get();
+			auto & cls = m_classes[c];
+
+			for ( size_t i = count; i-- > 0; ) {
+				auto block = new ( slab + i * stride ) t_block;
+				block->sizeClass = static_cast<uint32_t>( c );
+				block->pool = this;
+				block->next = cls.local;
+				cls.local = block;
+			}
+		}
+
+
+		t_block * acquire( size_t size )
+		{
+			m_refs.fetch_add( 1, std::memory_order_relaxed );
+
+			size_t c = 0;
+
+			while ( c < ClassCount && classBytes( c ) < size ) {
+				++c;
+			}
+
+			if ( ClassCount == c ) {
+				auto block = new ( ::operator new( sizeof( t_block ) + size ) ) t_block;
+				block->sizeClass = Unpooled;
+				block->pool = this;
+
+				return block;
+			}
+
+			auto & cls = m_classes[c];
+
+			if ( nullptr == cls.local ) {
+				cls.local = cls.released.exchange( nullptr, std::memory_order_acquire );
+			}
+
+			if ( nullptr == cls.local ) {
+				carve( c );
+			}
+
+			auto block = cls.local;
+			cls.local = block->next;
+			block->refs.store( 1, std::memory_order_relaxed );
+
+			return block;
+		}
+
+
+		void recycle( t_block * block )
+		{
+			if ( Unpooled == block->sizeClass ) {
+				block->~t_block();
+				::operator delete( block );
+			}
+			else {
+				auto & released = m_classes[block->sizeClass].released;
+				block->next = released.load( std::memory_order_relaxed );
+
+				while ( !released.compare_exchange_weak(
+					block->next, block, std::memory_order_release, std::memory_order_relaxed ) ) {
+				}
+			}
+
+			unref();
+		}
+
+
+		void unref()
+		{
+			if ( 1 == m_refs.fetch_sub( 1, std::memory_order_acq_rel ) ) {
+				delete this;
+			}
+		}
+
+	public:
+		BufferPool( const BufferPool & ) = delete;
+		BufferPool & operator=( const BufferPool & ) = delete;
+
+
+		static BufferPool * create()
+		{
+			return new BufferPool;
+		}
+
+
+		/// drops the owner reference
+		static void close( BufferPool * pool )
+		{
+			pool->unref();
+		}
+
+
+		/// any thread
+		static void release( t_block * block )
+		{
+			if ( 1 == block->refs.fetch_sub( 1, std::memory_order_acq_rel ) ) {
+				block->pool->recycle( block );
+			}
+		}
+
+
+		/// owner thread only
+		SharedBuffer copy( const void * data, size_t size );
+
+
+		/// owner thread only
+		size_t SlabCount() const
+		{
+			return m_slabs.size();
+		}
+	};
+
+
+	/// handle of a pooled buffer, or of a part of it; copies share the buffer, it is released with the last one
+	class SharedBuffer {
+		friend class BufferPool;
+
+	protected:
+		BufferPool::t_block * m_block = nullptr;
+		const char * m_data = nullptr;
+		size_t m_size = 0;
+
+	protected:
+		/// adopts the reference the block was handed out with
+		SharedBuffer( BufferPool::t_block * block, size_t size )
+			: m_block( block )
+			, m_data( reinterpret_cast<const char *>( block->Data() ) )
+			, m_size( size )
+		{
+		}
+
+	public:
+		SharedBuffer() = default;
+
+
+		SharedBuffer( const SharedBuffer & other )
+			: m_block( other.m_block )
+			, m_data( other.m_data )
+			, m_size( other.m_size )
+		{
+
+			if ( m_block != nullptr ) {
+				m_block->refs.fetch_add( 1, std::memory_order_relaxed );
+			}
+		}
+
+
+		SharedBuffer( SharedBuffer && other ) noexcept
+			: m_block( std::exchange( other.m_block, nullptr ) )
+			, m_data( std::exchange( other.m_data, nullptr ) )
+			, m_size( std::exchange( other.m_size, 0 ) )
+		{
+		}
+
+
+		SharedBuffer & operator=( SharedBuffer other ) noexcept
+		{
+			std::swap( m_block, other.m_block );
+			std::swap( m_data, other.m_data );
+			std::swap( m_size, other.m_size );
+
+			return *this;
+		}
+
+
+		~SharedBuffer()
+		{
+			if ( m_block != nullptr ) {
+				BufferPool::release( m_block );
+			}
+		}
+
+
+		const char * Data() const
+		{
+			return m_data;
+		}
+
+
+		size_t Size() const
+		{
+			return m_size;
+		}
+
+
+		bool IsEmpty() const
+		{
+			return 0 == m_size;
+		}
+
+
+		std::string_view View() const
+		{
+			return { m_data, m_size };
+		}
+
+
+		/// shares the buffer
+		SharedBuffer slice( size_t offset, size_t size ) const
+		{
+			SharedBuffer out( *this );
+			out.m_data += offset;
+			out.m_size = size;
+
+			return out;
+		}
+	};
+
+
+	inline SharedBuffer BufferPool::copy( const void * data, size_t size )
+	{
+		if ( 0 == size ) {
+			return {};
+		}
+
+		auto block = acquire( size );
+		std::memcpy( block->Data(), data, size );
+
+		return SharedBuffer( block, size );
+	}
+
+} // namespace as
+
+
+#endif
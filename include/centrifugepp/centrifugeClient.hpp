@@ -28,26 +28,242 @@
 #define __CENTRIFUGEPP__CENTRIFUGE_CLIENT__H
 
 
+#include <array>
+#include <deque>
+#include <thread>
+#include <span>
+#include <functional>
+#include <vector>
 #include <string_view>
+#include <type_traits>
 
 #include "logger.hpp"
 #include "wsClient.hpp"
+#include "spscRing.hpp"
+#include "affinity.hpp"
+#include "bufferPool.hpp"
+#include "channelRouter.hpp"
+#include "channelRegistry.hpp"
+#include "subscription.hpp"
 
 
 namespace as {
 
+	/// delivery class of a channel, each has its own queue per consumer
+	enum class t_priority {
+		High,
+		Normal,
+		Low,
+	};
+
+
+	inline constexpr size_t PriorityCount = 3;
+
+
+	/// what happens to publications of a class whose queue is overloaded
+	enum class t_shedPolicy {
+		/// the io thread waits for the consumer, nothing is lost
+		Block,
+		/// new publications are dropped while overloaded
+		Drop,
+		/// one in sampleEvery gets through while overloaded
+		Sample,
+	};
+
+
+	struct t_priorityOptions {
+		t_shedPolicy policy = t_shedPolicy::Block;
+		/// queued publications from which the class counts as overloaded, 0 - half of the capacity
+		size_t overloadItems = 0;
+		size_t sampleEvery = 16;
+	};
+
+
+	struct t_deliveryOptions {
+		/// 0 - the publication handler runs on the io thread, otherwise on this many consumer threads; channels are
+		/// spread over them by hash, so each channel keeps its order
+		size_t consumers = 0;
+		/// consumer i is pinned to cpus[i % size], empty - not pinned
+		std::vector<int> cpus;
+		/// per consumer, the io thread waits for a free slot when the ring is full
+		size_t capacity = 4096;
+		t_waitStrategy waitStrategy = t_waitStrategy::Futex;
+		/// bytes queued for the consumers above which socket reads pause, 0 - no budget; consumers > 0 only, the
+		/// io thread handler is its own back pressure. Consumers have to drain to the low watermark within the
+		/// server ping timeout, see WsClientBase::pauseRead()
+		size_t budgetBytes = 0;
+		/// reads resume once the queued bytes drop to this, 0 - half of the budget
+		size_t lowWatermarkBytes = 0;
+		/// by t_priority; consumers always drain the higher classes first, channels are Normal unless subscribed
+		/// with another class
+		std::array<t_priorityOptions, PriorityCount> priorities{ { {}, {}, { t_shedPolicy::Drop } } };
+	};
+
+
+	struct t_conflationSlot;
+	class CentrifugeClientBase;
+
+
+	/// handler of the channels routed to it, see CentrifugeClientBase::route()
+	using t_pubRoute = std::function<void( CentrifugeClientBase & client,
+		t_channelId channelId,
+		const std::string_view channelName,
+		const SharedBuffer & data )>;
+
+
+	/// calls a publication handler in the first of its forms that fits:
+	/// ( client, t_channelId, channel name, const SharedBuffer & ) - the payload may be kept beyond the call by copying
+	/// the handle, ( client, t_channelId, const SharedBuffer & ), ( client, t_channelId, channel name, payload view ),
+	/// ( client, t_channelId, payload view ), ( client, channel name, payload view )
+	template <typename T_handler>
+	void invokePubHandler( T_handler & handler,
+		CentrifugeClientBase & client,
+		t_channelId channelId,
+		const std::string_view channelName,
+		const SharedBuffer & data )
+	{
+		using t_view = const std::string_view;
+		using t_data = const SharedBuffer &;
+
+		if constexpr ( std::is_invocable_v<T_handler &, CentrifugeClientBase &, t_channelId, t_view, t_data> ) {
+			handler( client, channelId, channelName, data );
+		}
+		else if constexpr ( std::is_invocable_v<T_handler &, CentrifugeClientBase &, t_channelId, t_data> ) {
+			handler( client, channelId, data );
+		}
+		else if constexpr ( std::is_invocable_v<T_handler &, CentrifugeClientBase &, t_channelId, t_view, t_view> ) {
+			handler( client, channelId, channelName, data.View() );
+		}
+		else if constexpr ( std::is_invocable_v<T_handler &, CentrifugeClientBase &, t_channelId, t_view> ) {
+			handler( client, channelId, data.View() );
+		}
+		else {
+			handler( client, channelName, data.View() );
+		}
+	}
+
+
+	/// a publication as the batch handler sees it, valid for the duration of the call; buffer may be copied to keep
+	/// the payload
+	struct t_pubView {
+		t_channelId channelId;
+		std::string_view channel;
+		std::string_view data;
+		const SharedBuffer * buffer;
+	};
+
+
+	/// handler of the publications not routed elsewhere, see CentrifugeClientBase::batch()
+	using t_batchHandler = std::function<void( CentrifugeClientBase & client, std::span<const t_pubView> pubs )>;
+
+
+	struct t_batchOptions {
+		/// publications per call at most, 0 - no limit
+		size_t maxItems = 0;
+		/// io thread delivery: the publications of consecutive frames are gathered for up to this long, 0 - one call
+		/// per frame; consumer threads hand over what they have drained at once
+		t_timespan windowUs = 0;
+	};
+
+
+	/// a decoded publication
+	struct t_publication {
+		t_channelId channelId = ChannelRegistry::InvalidId;
+		/// the interned name, valid as long as the client
+		std::string_view channel;
+		SharedBuffer data;
+		/// resolved on the io thread, null - the catch-all publication handler
+		const t_pubRoute * route = nullptr;
+		/// conflated channels: the ring only carries the slot, the publication waits in it
+		t_conflationSlot * slot = nullptr;
+		/// steady clock, when the io thread handed it over
+		int64_t receivedNs = 0;
+	};
+
+
+	/// latest publication of a conflated channel that the consumer has not taken yet
+	struct t_conflationSlot {
+		std::atomic<t_publication *> pending{ nullptr };
+	};
+
+
+	struct t_deliveryStats {
+		size_t delivered = 0;
+		/// publications replaced in their slot before the consumer took them
+		size_t conflated = 0;
+		/// publications dropped or sampled out by the policy of an overloaded class
+		size_t shed = 0;
+		/// from the io thread handing a publication over to its handler being called
+		double lagAvgUs = 0;
+		double lagMaxUs = 0;
+	};
+
+
 	class CentrifugeClientBase {
 	protected:
+		/// open(), outlives the connection that runs on it
+		std::unique_ptr<boost::asio::io_context> m_driveIo;
 		std::unique_ptr<as::WsClientBase> m_wsClient;
 		t_timespan m_wsTimeoutMs{ 0 };
+		t_wsOptions m_wsOptions;
+		t_timespan m_reconnectDelayMs{ 1000 };
+
+		struct t_consumer {
+			Doorbell bell;
+			std::array<std::unique_ptr<SpscRing<t_publication>>, PriorityCount> rings;
+			std::thread thread;
+		};
+
+	protected:
+		t_deliveryOptions m_delivery;
+		std::vector<std::unique_ptr<t_consumer>> m_consumers;
+		std::atomic_size_t m_queuedBytes{ 0 };
+		/// payloads, taken on the io thread
+		std::unique_ptr<BufferPool, void ( * )( BufferPool * )> m_pool{ BufferPool::create(), &BufferPool::close };
+		size_t m_peakQueuedBytes = 0;
+
+		ChannelRegistry m_channels;
+		ChannelRouter<t_pubRoute> m_router;
+
+		std::deque<Subscription> m_subscriptions;
+
+		t_batchHandler m_batchHandler;
+		t_batchOptions m_batchOptions;
+		/// io thread delivery
+		std::vector<t_publication> m_batch;
+		std::vector<t_pubView> m_batchViews;
+		int64_t m_batchStartNs = 0;
+		std::deque<t_conflationSlot> m_slots;
+		std::vector<t_conflationSlot *> m_conflation;
+
+		std::vector<t_priority> m_priorities;
+		std::array<size_t, PriorityCount> m_sampleCounters{};
+		std::atomic_size_t m_shedCount{ 0 };
+
+		std::atomic_size_t m_deliveredCount{ 0 };
+		std::atomic_size_t m_conflatedCount{ 0 };
+		std::atomic_int64_t m_lagTotalNs{ 0 };
+		std::atomic_int64_t m_lagMaxNs{ 0 };
 
 		std::atomic_uint32_t m_messageId{ 1 };
 
+		std::atomic_bool m_isRunning{ false };
+		std::atomic_bool m_isSessionEstablished{ false };
+		size_t m_connectionCount = 0;
+
+		/// shared io context
+		std::unique_ptr<boost::asio::steady_timer> m_reconnectTimer;
+		std::function<void()> m_stoppedHandler;
+		/// shared io context, io thread: the connection has been started and has not reported its stop yet
+		bool m_isSessionRunning = false;
+
 	protected:
 		virtual t_string Token() = 0;
 		virtual void OnConnect( CentrifugeClientBase & client ) = 0;
-		virtual void OnPub(
-			CentrifugeClientBase & client, const std::string_view channelName, const std::string_view data ) = 0;
+		virtual void OnPub( CentrifugeClientBase & client,
+			t_channelId channelId,
+			const std::string_view channelName,
+			const SharedBuffer & data ) = 0;
 
 		void wsErrorHandler( as::WsClientBase & client, int code, const as::t_stringview & message )
 		{
@@ -58,6 +274,47 @@ namespace as {
 		void wsHandshakeHandler( as::WsClientBase & client );
 		bool wsReadHandler( as::WsClientBase & client, const char * data, size_t size );
 
+		static bool peekPublication(
+			const t_byte * data, size_t size, std::string_view & channel, std::string_view & payload );
+
+		void accept( as::WsClientBase & client, t_publication && pub );
+		void dispatch( const t_pubRoute * route,
+			t_channelId channelId,
+			const std::string_view channelName,
+			const SharedBuffer & data );
+
+		void gather( as::WsClientBase & client, t_publication && pub );
+		void flushBatch();
+		void deliverBatch( std::vector<t_publication> & batch, std::vector<t_pubView> & views );
+
+		bool isBatchFull( const std::vector<t_publication> & batch ) const
+		{
+			return m_batchOptions.maxItems > 0 && batch.size() >= m_batchOptions.maxItems;
+		}
+
+		void startSession();
+		void OnSessionStopped();
+		void finish();
+
+		void startConsumers();
+		void stopConsumers();
+		void closeSubscriptions();
+		void consume( t_consumer & consumer );
+		bool take( t_consumer & consumer, t_publication & pub );
+		void deliver( t_publication && pub );
+		t_priority priority( t_channelId id ) const;
+		bool shed( const SpscRing<t_publication> & ring, t_priority priority );
+		bool conflate( t_publication & pub );
+		void countDelivery( int64_t receivedNs );
+		void release( size_t bytes );
+		void applyBudget( as::WsClientBase & client );
+
+
+		size_t lowWatermark() const
+		{
+			return m_delivery.lowWatermarkBytes > 0 ? m_delivery.lowWatermarkBytes : m_delivery.budgetBytes / 2;
+		}
+
 	public:
 		template <typename T> static void serialize( std::string & message, const T & command )
 		{
@@ -112,7 +369,208 @@ namespace as {
 		}
 
 
+		/// the underlying websocket client, null until run() has started
+		const as::WsClientBase * Connection() const
+		{
+			return m_wsClient.get();
+		}
+
+
+		/// transport options, to be set before run()
+		void WsOptions( const t_wsOptions & options )
+		{
+			m_wsOptions = options;
+		}
+
+
+		size_t QueuedBytes() const
+		{
+			return m_queuedBytes;
+		}
+
+
+		/// io thread view
+		size_t PeakQueuedBytes() const
+		{
+			return m_peakQueuedBytes;
+		}
+
+
+		/// io thread only; ids are assigned on subscribe() or on the first publication of a channel
+		const t_string & ChannelName( t_channelId id ) const
+		{
+			return m_channels.Name( id );
+		}
+
+
+		t_channelId ChannelId( const t_stringview name ) const
+		{
+			return m_channels.find( name );
+		}
+
+
+		t_deliveryStats DeliveryStats() const
+		{
+			t_deliveryStats stats;
+			stats.delivered = m_deliveredCount;
+			stats.conflated = m_conflatedCount;
+			stats.shed = m_shedCount;
+			stats.lagAvgUs = 0 == stats.delivered ? 0.0 : m_lagTotalNs / 1e3 / stats.delivered;
+			stats.lagMaxUs = m_lagMaxNs / 1e3;
+
+			return stats;
+		}
+
+
+		/// to be set before run()
+		void Delivery( const t_deliveryOptions & options )
+		{
+			m_delivery = options;
+		}
+
+
+		const t_deliveryOptions & Delivery() const
+		{
+			return m_delivery;
+		}
+
+
+		void ReconnectDelayMs( t_timespan t )
+		{
+			m_reconnectDelayMs = t;
+		}
+
+
+		/// drops the current connection, run() connects again; any thread with run(), the io thread with start()
+		void reconnect()
+		{
+			if ( m_wsClient ) {
+				m_wsClient->stop();
+			}
+		}
+
+
+		/// makes run() return once the current connection is dropped
+		void stop()
+		{
+			if ( !m_reconnectTimer ) {
+				m_isRunning = false;
+				reconnect();
+				return;
+			}
+
+			// the client may be destroyed from its stopped handler on, so it is finished by whatever the io thread
+			// runs next for it and nothing is posted after that: between two connections the pending timer handler,
+			// otherwise the connection once it has stopped
+			boost::asio::post( m_reconnectTimer->get_executor(), [this] {
+				m_isRunning = false;
+
+				if ( m_isSessionRunning ) {
+					reconnect();
+				}
+				else {
+					m_reconnectTimer->cancel();
+				}
+			} );
+		}
+
+
+		/// runs the client on io, which other clients may share (see Engine), instead of on a thread of its own;
+		/// returns at once, stoppedHandler runs on the io thread once stop() has taken effect
+		virtual void start( boost::asio::io_context & io, std::function<void()> && stoppedHandler = {} ) = 0;
+
+
+		/// no thread of its own: the client runs on the thread that calls poll() or runFor(), handlers included;
+		/// an outside event loop watches Connection()->NativeHandle() and calls poll() when it is readable, and
+		/// at least every few milliseconds for the timers
+		void open( std::function<void()> && stoppedHandler = {} )
+		{
+			m_driveIo = std::make_unique<boost::asio::io_context>( 1 );
+			start( *m_driveIo, std::move( stoppedHandler ) );
+		}
+
+
+		/// open() only, runs the handlers that are ready, returns how many
+		size_t poll()
+		{
+			return m_driveIo->poll();
+		}
+
+
+		/// open() only, runs handlers for up to us
+		size_t runFor( t_timespan us )
+		{
+			return m_driveIo->run_for( std::chrono::microseconds( us ) );
+		}
+
+
+		/// open() only, the client has stopped and poll() has nothing left to do
+		bool IsStopped() const
+		{
+			return m_driveIo->stopped();
+		}
+
+
+		/// io thread, the connect reply of the current connection has arrived
+		bool IsSessionEstablished() const
+		{
+			return m_isSessionEstablished;
+		}
+
+
 		void subscribe( const as::t_stringview channel );
+
+		/// publications already received for the channel are still delivered
+		void unsubscribe( const as::t_stringview channel );
+
+		/// also tags the channel with a delivery class, from the connect handler like subscribe()
+		void subscribe( const as::t_stringview channel, t_priority priority );
+
+		/// only the latest publication of the channel waits for its consumer, to be called before run(); takes effect
+		/// with queued delivery (t_deliveryOptions::consumers)
+		void conflate( const as::t_stringview channel );
+
+
+		/// publications of the channels matching pattern, as route() matches them, queued for a coroutine instead of
+		/// handed to a handler; the channels still have to be subscribed. To be called before run(). io thread
+		/// delivery only: with t_deliveryOptions::consumers > 0 the subscription is closed when the client starts
+		Subscription & stream( const as::t_stringview pattern, size_t capacity = 1024 )
+		{
+			auto & sub = m_subscriptions.emplace_back( capacity );
+
+			route( pattern, [&sub]( CentrifugeClientBase & client, t_channelId channelId, const SharedBuffer & data ) {
+				sub.push( { channelId, client.ChannelName( channelId ), data } );
+			} );
+
+			return sub;
+		}
+
+
+		/// the publications that would go to the catch-all handler go to handler instead, as many per call as one
+		/// frame carries, or a consumer thread has drained; to be set before run()
+		void batch( t_batchHandler && handler, const t_batchOptions & options = {} )
+		{
+			m_batchHandler = std::move( handler );
+			m_batchOptions = options;
+		}
+
+
+		/// publications of the channels matching pattern go to handler instead of the catch-all one; "ns:*" matches
+		/// the namespace prefix, the longest pattern wins; isExact - pattern is taken as a channel name, '*' and all.
+		/// handler takes any form invokePubHandler() knows. To be called before run() or from the connect handler
+		template <typename T_handler>
+		void route( const as::t_stringview pattern, T_handler && handler, bool isExact = false )
+		{
+			m_router.add(
+				pattern,
+				[h = std::decay_t<T_handler>( std::forward<T_handler>( handler ) )]( CentrifugeClientBase & client,
+					t_channelId channelId,
+					const std::string_view channelName,
+					const SharedBuffer & data ) mutable {
+					invokePubHandler( h, client, channelId, channelName, data );
+				},
+				isExact );
+		}
 	};
 
 
@@ -137,15 +595,16 @@ namespace as {
 		}
 
 
-		void OnPub(
-			CentrifugeClientBase & client, const std::string_view channelName, const std::string_view data ) override
+		void OnPub( CentrifugeClientBase & client,
+			t_channelId channelId,
+			const std::string_view channelName,
+			const SharedBuffer & data ) override
 		{
-
-			m_pubHandler( client, channelName, data );
+			invokePubHandler( m_pubHandler, client, channelId, channelName, data );
 		}
 
 
-		void initWsClient()
+		void initWsClient( boost::asio::io_context * io = nullptr )
 		{
 			m_wsClient.reset( new as::WsClient(
 				Url( m_wsUrl ),
@@ -155,9 +614,11 @@ namespace as {
 				[this]( as::WsClientBase & client ) { wsHandshakeHandler( client ); },
 				[this]( as::WsClientBase & client, const char * data, size_t size ) {
 					return wsReadHandler( client, data, size );
-				} ) );
+				},
+				io ) );
 
 			m_wsClient->WatchdogTimeoutMs( m_wsTimeoutMs );
+			m_wsClient->Options( m_wsOptions );
 		}
 
 	public:
@@ -175,22 +636,55 @@ namespace as {
 
 		void run()
 		{
+			m_isRunning = true;
+
+			// before the thread, reconnect() and stop() may read it from any thread from here on
+			if ( !m_wsClient ) {
+				initWsClient();
+			}
+
+			startConsumers();
+
 			std::thread t( [this] {
-				size_t wsClientId = 1;
+				while ( m_isRunning ) {
+					m_isSessionEstablished = false;
 
-				while ( true ) {
 					try {
-						initWsClient();
-						m_wsClient->Id( std::to_string( wsClientId++ ) );
+						m_wsClient->Id( std::to_string( ++m_connectionCount ) );
 						m_wsClient->run();
 					}
 					catch ( const std::exception & x ) {
 						AS_LOG_ERROR_LINE( x.what() );
 					}
+
+					// a window still open when the connection dropped
+					flushBatch();
+
+					// an established session is restored at once, failed attempts are throttled
+					if ( m_isRunning && !m_isSessionEstablished ) {
+						std::this_thread::sleep_for( std::chrono::milliseconds( m_reconnectDelayMs ) );
+					}
 				}
 			} );
 
 			t.join();
+			stopConsumers();
+			closeSubscriptions();
+		}
+
+
+		void start( boost::asio::io_context & io, std::function<void()> && stoppedHandler = {} ) override
+		{
+			m_isRunning = true;
+			m_stoppedHandler = std::move( stoppedHandler );
+			m_reconnectTimer = std::make_unique<boost::asio::steady_timer>( io );
+			startConsumers();
+
+			// the connection and its buffers are allocated by the io thread, next to its core
+			boost::asio::post( io, [this, &io] {
+				initWsClient( &io );
+				startSession();
+			} );
 		}
 	};
 
@@ -0,0 +1,150 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// channelRegistry.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__CHANNEL_REGISTRY__H
+#define __CENTRIFUGEPP__CHANNEL_REGISTRY__H
+
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "core.hpp"
+
+
+namespace as {
+
+	using t_channelId = uint32_t;
+
+
+	/// channel names interned to dense ids, ids are never reused
+	///
+	/// open addressing over (hash, id) pairs: a lookup hashes the name once and compares names only when the stored
+	/// hashes match; growing reuses the stored hashes. Not synchronized, owned by the io thread; names stay at the
+	/// same address for the lifetime of the registry
+	class ChannelRegistry {
+	public:
+		static constexpr t_channelId InvalidId = ~t_channelId( 0 );
+
+	protected:
+		struct t_entry {
+			size_t hash = 0;
+			t_channelId id = InvalidId;
+		};
+
+	protected:
+		std::vector<t_entry> m_table = std::vector<t_entry>( 16 );
+		std::deque<t_string> m_names;
+		std::vector<size_t> m_hashes;
+
+	protected:
+		/// slot of name, or the empty one where it would go
+		size_t probe( const t_stringview name, size_t hash ) const
+		{
+			auto mask = m_table.size() - 1;
+
+			for ( auto i = hash & mask;; i = ( i + 1 ) & mask ) {
+				const auto & e = m_table[i];
+
+				if ( InvalidId == e.id || ( e.hash == hash && m_names[e.id] == name ) ) {
+					return i;
+				}
+			}
+		}
+
+
+		void grow()
+		{
+			std::vector<t_entry> table( m_table.size() * 2 );
+			auto mask = table.size() - 1;
+
+			for ( t_channelId id = 0; id < m_names.size(); ++id ) {
+				auto i = m_hashes[id] & mask;
+
+				while ( table[i].id != InvalidId ) {
+					i = ( i + 1 ) & mask;
+				}
+
+				table[i] = { m_hashes[id], id };
+			}
+
+			m_table.swap( table );
+		}
+
+	public:
+		static size_t hash( const t_stringview name )
+		{
+			return std::hash<t_stringview>{}( name );
+		}
+
+
+		t_channelId intern( const t_stringview name )
+		{
+			auto h = hash( name );
+			auto i = probe( name, h );
+
+			if ( m_table[i].id != InvalidId ) {
+				return m_table[i].id;
+			}
+
+			// load factor stays at or below one half
+			if ( ( m_names.size() + 1 ) * 2 > m_table.size() ) {
+				grow();
+				i = probe( name, h );
+			}
+
+			auto id = static_cast<t_channelId>( m_names.size() );
+			m_names.emplace_back( name );
+			m_hashes.push_back( h );
+			m_table[i] = { h, id };
+
+			return id;
+		}
+
+
+		t_channelId find( const t_stringview name ) const
+		{
+			return m_table[probe( name, hash( name ) )].id;
+		}
+
+
+		const t_string & Name( t_channelId id ) const
+		{
+			return m_names[id];
+		}
+
+
+		size_t Size() const
+		{
+			return m_names.size();
+		}
+	};
+
+} // namespace as
+
+
+#endif
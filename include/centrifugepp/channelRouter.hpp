@@ -0,0 +1,159 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// channelRouter.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__CHANNEL_ROUTER__H
+#define __CENTRIFUGEPP__CHANNEL_ROUTER__H
+
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "core.hpp"
+#include "channelRegistry.hpp"
+
+
+namespace as {
+
+	/// handlers by channel name or by namespace prefix
+	///
+	/// patterns are compiled into a prefix trie; a channel is matched against it once, the handler it resolves to
+	/// is cached by channel id, so dispatch is an array lookup. Not synchronized, owned by the io thread; handlers
+	/// stay at the same address for the lifetime of the router
+	template <typename T_handler> class ChannelRouter {
+	protected:
+		static constexpr uint32_t Unresolved = ~uint32_t( 0 );
+		static constexpr uint32_t NoRoute = Unresolved - 1;
+
+		struct t_node {
+			std::vector<std::pair<char, uint32_t>> children;
+			/// handler index of the pattern ending here, and of the one ending here with '*'
+			uint32_t exact = NoRoute;
+			uint32_t prefix = NoRoute;
+		};
+
+	protected:
+		std::vector<t_node> m_nodes = std::vector<t_node>( 1 );
+		std::deque<T_handler> m_handlers;
+		/// handler index by channel id
+		std::vector<uint32_t> m_cache;
+
+	protected:
+		uint32_t child( uint32_t node, char c ) const
+		{
+			for ( const auto & p : m_nodes[node].children ) {
+				if ( p.first == c ) {
+					return p.second;
+				}
+			}
+
+			return NoRoute;
+		}
+
+
+		/// the longest pattern matching name wins, an exact one over a prefix of the same length
+		uint32_t match( const t_stringview name ) const
+		{
+			uint32_t node = 0;
+			auto out = m_nodes[0].prefix;
+
+			for ( auto c : name ) {
+				if ( ( node = child( node, c ) ) == NoRoute ) {
+					return out;
+				}
+
+				if ( m_nodes[node].prefix != NoRoute ) {
+					out = m_nodes[node].prefix;
+				}
+			}
+
+			return m_nodes[node].exact != NoRoute ? m_nodes[node].exact : out;
+		}
+
+	public:
+		bool IsEmpty() const
+		{
+			return m_handlers.empty();
+		}
+
+
+		/// "ns:*" - every channel starting with "ns:", "*" - every channel, anything else - that channel only;
+		/// isExact - pattern is a channel name, a trailing '*' included. A pattern added again gets the new handler
+		void add( const t_stringview pattern, T_handler && handler, bool isExact = false )
+		{
+			auto isPrefix = !isExact && !pattern.empty() && '*' == pattern.back();
+			auto path = isPrefix ? pattern.substr( 0, pattern.size() - 1 ) : pattern;
+
+			uint32_t node = 0;
+
+			for ( auto c : path ) {
+				auto next = child( node, c );
+
+				if ( NoRoute == next ) {
+					next = static_cast<uint32_t>( m_nodes.size() );
+					m_nodes[node].children.emplace_back( c, next );
+					m_nodes.emplace_back();
+				}
+
+				node = next;
+			}
+
+			// the replaced handler stays alive, a consumer thread may still be running it
+			auto index = static_cast<uint32_t>( m_handlers.size() );
+			m_handlers.push_back( std::move( handler ) );
+
+			( isPrefix ? m_nodes[node].prefix : m_nodes[node].exact ) = index;
+
+			m_cache.clear();
+		}
+
+
+		/// handler of the channel, null when no pattern matches
+		const T_handler * resolve( t_channelId id, const t_stringview name )
+		{
+			if ( m_handlers.empty() ) {
+				return nullptr;
+			}
+
+			if ( id >= m_cache.size() ) {
+				m_cache.resize( id + 1, Unresolved );
+			}
+
+			auto & index = m_cache[id];
+
+			if ( Unresolved == index ) {
+				index = match( name );
+			}
+
+			return NoRoute == index ? nullptr : &m_handlers[index];
+		}
+	};
+
+} // namespace as
+
+
+#endif
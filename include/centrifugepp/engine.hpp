@@ -0,0 +1,125 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// engine.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__ENGINE__H
+#define __CENTRIFUGEPP__ENGINE__H
+
+
+#include <list>
+#include <mutex>
+#include <deque>
+#include <thread>
+#include <future>
+#include <vector>
+#include <optional>
+#include <condition_variable>
+
+#include "boost/asio/io_context.hpp"
+#include "boost/asio/executor_work_guard.hpp"
+
+#include "core.hpp"
+#include "centrifugeClient.hpp"
+
+
+namespace as {
+
+	struct t_engineOptions {
+		/// one core thread per entry, pinned to that cpu (-1 - not pinned); empty - one per hardware thread
+		std::vector<int> cpus;
+	};
+
+
+	/// thread-per-core runtime: every core runs one io context on a pinned thread and owns the connections added to
+	/// it, so a connection, its buffers and its handlers never leave that core
+	///
+	/// memory is placed by first touch: connections are created on their core thread, which keeps them on the NUMA
+	/// node of that core under the default kernel policy
+	class Engine {
+	public:
+		static constexpr size_t AnyCore = size_t( -1 );
+
+	protected:
+		struct t_core {
+			int cpu = -1;
+			boost::asio::io_context io{ 1 };
+			std::optional<boost::asio::executor_work_guard<boost::asio::io_context::executor_type>> work;
+			std::thread thread;
+			size_t clients = 0;
+		};
+
+		struct t_client {
+			CentrifugeClientBase * client;
+			size_t core;
+		};
+
+	protected:
+		std::deque<t_core> m_cores;
+
+		std::mutex m_sync;
+		std::condition_variable m_stopped;
+		std::list<t_client> m_clients;
+
+	protected:
+		void OnClientStopped( std::list<t_client>::iterator it );
+
+	public:
+		explicit Engine( const t_engineOptions & options = {} );
+		~Engine();
+
+		Engine( const Engine & ) = delete;
+		Engine & operator=( const Engine & ) = delete;
+
+
+		size_t CoreCount() const
+		{
+			return m_cores.size();
+		}
+
+
+		boost::asio::io_context & Io( size_t core )
+		{
+			return m_cores[core].io;
+		}
+
+
+		/// starts client on core, AnyCore - the one with the fewest clients; returns the core. The client lives until
+		/// it has stopped and goes away before the engine, its connection belongs to the core's io context
+		size_t add( CentrifugeClientBase & client, size_t core = AnyCore );
+
+		/// asks every client to stop and waits for them
+		void stop();
+
+		/// blocks until no client is running
+		void wait();
+
+		/// not from a core thread: blocks until every core has run what was posted to it before
+		void sync();
+	};
+
+} // namespace as
+
+
+#endif
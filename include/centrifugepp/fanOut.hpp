@@ -0,0 +1,134 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// fanOut.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__FAN_OUT__H
+#define __CENTRIFUGEPP__FAN_OUT__H
+
+
+#include <deque>
+#include <cstdint>
+#include <unordered_map>
+
+#include "core.hpp"
+#include "centrifugeClient.hpp"
+
+
+namespace as {
+
+	using t_subscriberId = uint64_t;
+
+
+	/// local subscribers sharing the upstream subscriptions of one client: a channel is subscribed upstream when its
+	/// first subscriber comes and unsubscribed when the last one leaves; every subscriber of the channel gets the
+	/// same buffer of a publication
+	///
+	/// io thread of the client, or before it runs; resubscribe() goes into the connect handler. A handler may add or
+	/// remove subscribers, itself included. Handlers run on the io thread, so the client has to deliver there
+	/// (t_deliveryOptions::consumers = 0, set before the first subscriber); subscribe() returns InvalidId otherwise
+	class FanOut {
+	public:
+		static constexpr t_subscriberId InvalidId = 0;
+
+	protected:
+		struct t_subscriber {
+			t_subscriberId id;
+			t_pubRoute handler;
+			/// dropped once no delivery walks the channel, the handler may be the one running
+			bool isRemoved = false;
+		};
+
+		struct t_channel {
+			t_string name;
+			/// stable while a delivery walks it
+			std::deque<t_subscriber> subscribers;
+			size_t count = 0;
+			size_t depth = 0;
+			bool isRouted = false;
+		};
+
+	protected:
+		CentrifugeClientBase & m_client;
+
+		/// kept once created, the channel's route refers to it
+		std::unordered_map<t_string, t_channel> m_channels;
+		std::unordered_map<t_subscriberId, t_channel *> m_subscribers;
+		t_subscriberId m_nextId = 1;
+
+		size_t m_upstreamCount = 0;
+
+	protected:
+		t_subscriberId add( const as::t_stringview channel, t_pubRoute && handler );
+		void deliver( t_channel & ch, t_channelId channelId, const std::string_view name, const SharedBuffer & data );
+		static void compact( t_channel & ch );
+
+	public:
+		explicit FanOut( CentrifugeClientBase & client )
+			: m_client( client )
+		{
+		}
+
+
+		FanOut( const FanOut & ) = delete;
+		FanOut & operator=( const FanOut & ) = delete;
+
+
+		/// handler takes any form invokePubHandler() knows
+		template <typename T_handler> t_subscriberId subscribe( const as::t_stringview channel, T_handler && handler )
+		{
+			return add( channel,
+				[h = std::decay_t<T_handler>( std::forward<T_handler>( handler ) )]( CentrifugeClientBase & client,
+					t_channelId channelId,
+					const std::string_view channelName,
+					const SharedBuffer & data ) mutable {
+					invokePubHandler( h, client, channelId, channelName, data );
+				} );
+		}
+
+
+		void unsubscribe( t_subscriberId id );
+
+		/// subscribes the channels with subscribers on the new connection
+		void resubscribe();
+
+
+		size_t SubscriberCount( const as::t_stringview channel ) const
+		{
+			auto it = m_channels.find( t_string( channel ) );
+			return m_channels.end() == it ? 0 : it->second.count;
+		}
+
+
+		/// channels subscribed upstream
+		size_t UpstreamCount() const
+		{
+			return m_upstreamCount;
+		}
+	};
+
+} // namespace as
+
+
+#endif
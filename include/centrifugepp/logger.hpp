@@ -42,7 +42,7 @@ namespace as {
 			 << " - " << std::this_thread::get_id() << " [" << a_categoryName << "] " << __FILE__ << AS_T( ", " )      \
 			 << __func__ << AS_T( ':' ) << __LINE__ << ":: " << a_m
 
-#if 0
+#if defined( NDEBUG )
 #define AS_LOG_TRACE( m )
 #define AS_LOG_DEBUG( m )
 #else
@@ -0,0 +1,147 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// resolverCache.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__RESOLVER_CACHE__H
+#define __CENTRIFUGEPP__RESOLVER_CACHE__H
+
+
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+
+#include "boost/asio/ip/tcp.hpp"
+
+#include "core.hpp"
+
+
+namespace as {
+
+	/// resolved endpoints by "host:port", shared by all connections of the process
+	///
+	/// the system resolver does not report record TTLs, entries live for TtlMs()
+	class ResolverCache {
+	public:
+		using t_endpoints = std::vector<boost::asio::ip::tcp::endpoint>;
+
+	protected:
+		struct t_entry {
+			t_endpoints endpoints;
+			std::chrono::steady_clock::time_point expiresAt;
+		};
+
+	protected:
+		std::mutex m_sync;
+		std::unordered_map<t_string, t_entry> m_entries;
+		t_timespan m_ttlMs = 60 * 1000;
+
+	public:
+		static ResolverCache & instance()
+		{
+			static ResolverCache cache;
+			return cache;
+		}
+
+
+		/// interleaves address families, starting with the family of the first result (RFC 8305)
+		static t_endpoints interleave( const boost::asio::ip::tcp::resolver::results_type & results )
+		{
+			t_endpoints primary;
+			t_endpoints secondary;
+
+			for ( const auto & r : results ) {
+				auto & list = primary.empty() || primary[0].protocol() == r.endpoint().protocol() ? primary : secondary;
+				list.push_back( r.endpoint() );
+			}
+
+			t_endpoints out;
+			out.reserve( primary.size() + secondary.size() );
+
+			for ( size_t i = 0; i < primary.size() || i < secondary.size(); ++i ) {
+				if ( i < primary.size() ) {
+					out.push_back( primary[i] );
+				}
+
+				if ( i < secondary.size() ) {
+					out.push_back( secondary[i] );
+				}
+			}
+
+			return out;
+		}
+
+
+		void TtlMs( t_timespan t )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+			m_ttlMs = t;
+		}
+
+
+		bool get( const t_string & key, t_endpoints & out )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			auto it = m_entries.find( key );
+
+			if ( m_entries.end() == it ) {
+				return false;
+			}
+
+			if ( std::chrono::steady_clock::now() >= it->second.expiresAt ) {
+				m_entries.erase( it );
+				return false;
+			}
+
+			out = it->second.endpoints;
+
+			return true;
+		}
+
+
+		void put( const t_string & key, const t_endpoints & endpoints )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			if ( m_ttlMs <= 0 ) {
+				return;
+			}
+
+			m_entries[key] = { endpoints, std::chrono::steady_clock::now() + std::chrono::milliseconds( m_ttlMs ) };
+		}
+
+
+		void erase( const t_string & key )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+			m_entries.erase( key );
+		}
+	};
+
+} // namespace as
+
+
+#endif
@@ -0,0 +1,195 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// shardedClient.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__SHARDED_CLIENT__H
+#define __CENTRIFUGEPP__SHARDED_CLIENT__H
+
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <algorithm>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "core.hpp"
+#include "engine.hpp"
+#include "centrifugeClient.hpp"
+
+
+namespace as {
+
+	struct t_shardOptions {
+		size_t shards = 1;
+		/// points per shard on the hash ring, more spread the channels more evenly
+		size_t virtualNodes = 64;
+		t_engineOptions engine;
+	};
+
+
+	/// channels partitioned over several connections to the same server by consistent hashing, each connection
+	/// reconnecting on its own
+	///
+	/// the shards run on an Engine; the publication handler is shared and called on the io thread of the shard that
+	/// owns the channel, so concurrently for channels of different shards. The channel id it gets is the one of the
+	/// sharded client: dense, given by subscribe() and kept when the channel moves to another shard (handlers set
+	/// on a Shard() directly get the ids of that shard). Changing the shard count moves only the channels whose
+	/// owner changes, see resize()
+	class ShardedClient {
+	public:
+		using t_shardClient = CentrifugeClient<std::function<t_string()>,
+			std::function<void( CentrifugeClientBase & )>,
+			t_pubRoute>;
+
+	protected:
+		struct t_shard {
+			std::unique_ptr<t_shardClient> client;
+			size_t core = 0;
+			/// io thread of the shard, subscribed again on every connect
+			std::unordered_set<t_string> channels;
+			/// io thread of the shard: id of the sharded client by name, kept once the channel has left, and by id
+			/// of the shard client once a publication has looked it up
+			std::unordered_map<t_string, t_channelId> ids;
+			std::vector<t_channelId> idsByLocal;
+			bool isRetired = false;
+		};
+
+		struct t_point {
+			uint64_t hash;
+			uint32_t shard;
+
+			bool operator<( const t_point & other ) const
+			{
+				return hash < other.hash;
+			}
+		};
+
+	protected:
+		t_string m_wsUrl;
+		std::function<t_string()> m_tokenFunc;
+		t_pubRoute m_pubHandler;
+		t_shardOptions m_options;
+		bool m_isStarted = false;
+
+		/// outlives the shards, their sockets and timers belong to its io contexts
+		Engine m_engine;
+
+		std::vector<std::unique_ptr<t_shard>> m_shards;
+		/// removed by resize(), kept until the engine has stopped
+		std::vector<std::unique_ptr<t_shard>> m_retired;
+		std::vector<t_point> m_ring;
+
+		/// in subscription order
+		std::vector<t_string> m_channels;
+		std::unordered_set<t_string> m_channelSet;
+		/// thread of the owner, the ids the handler gets
+		ChannelRegistry m_ids;
+
+	protected:
+		static uint64_t mix( uint64_t x )
+		{
+			x += 0x9e3779b97f4a7c15;
+			x = ( x ^ ( x >> 30 ) ) * 0xbf58476d1ce4e5b9;
+			x = ( x ^ ( x >> 27 ) ) * 0x94d049bb133111eb;
+
+			return x ^ ( x >> 31 );
+		}
+
+		static void attach( t_shard & shard, const t_string & channel, t_channelId id );
+		static void detach( t_shard & shard, const t_string & channel, t_channelId id );
+		static t_channelId globalId( t_shard & shard, t_channelId localId, const std::string_view channel );
+
+		void addShard();
+		void buildRing();
+		void post(
+			t_shard & shard, void ( *f )( t_shard &, const t_string &, t_channelId ), const as::t_stringview channel );
+
+	public:
+		/// pubHandler takes any form invokePubHandler() knows
+		template <typename T_tokenFunc, typename T_pubHandler>
+		ShardedClient( const as::t_stringview wsUrl,
+			T_tokenFunc && tokenFunc,
+			T_pubHandler && pubHandler,
+			const t_shardOptions & options = {} )
+			: m_wsUrl( wsUrl )
+			, m_tokenFunc( std::forward<T_tokenFunc>( tokenFunc ) )
+			, m_pubHandler( [h = std::decay_t<T_pubHandler>( std::forward<T_pubHandler>( pubHandler ) )](
+								CentrifugeClientBase & client,
+								t_channelId channelId,
+								const std::string_view channelName,
+								const SharedBuffer & data ) mutable {
+				invokePubHandler( h, client, channelId, channelName, data );
+			} )
+			, m_options( options )
+			, m_engine( options.engine )
+		{
+			for ( size_t i = 0; i < std::max<size_t>( m_options.shards, 1 ); ++i ) {
+				addShard();
+			}
+
+			buildRing();
+		}
+
+
+		~ShardedClient();
+
+		ShardedClient( const ShardedClient & ) = delete;
+		ShardedClient & operator=( const ShardedClient & ) = delete;
+
+
+		size_t ShardCount() const
+		{
+			return m_shards.size();
+		}
+
+
+		/// for the connection and delivery options, to be set before start()
+		CentrifugeClientBase & Shard( size_t shard )
+		{
+			return *m_shards[shard]->client;
+		}
+
+
+		size_t ShardOf( const as::t_stringview channel ) const;
+
+		/// thread of the owner
+		void start();
+		void stop();
+		void wait();
+
+		void subscribe( const as::t_stringview channel );
+		void unsubscribe( const as::t_stringview channel );
+
+		/// moves the channels whose shard changes, returns how many moved; a moved channel may be delivered twice
+		/// or miss publications while it moves
+		size_t resize( size_t shards );
+	};
+
+} // namespace as
+
+
+#endif
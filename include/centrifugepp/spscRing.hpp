@@ -0,0 +1,293 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// spscRing.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__SPSC_RING__H
+#define __CENTRIFUGEPP__SPSC_RING__H
+
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <optional>
+
+#include "core.hpp"
+
+
+namespace as {
+
+	/// how a side of the ring waits for the other one
+	enum class t_waitStrategy {
+		/// busy loop, lowest latency, burns a core
+		Spin,
+		/// busy loop that gives the time slice away
+		Yield,
+		/// spins for a while, then sleeps in the kernel until woken (std::atomic::wait)
+		Futex,
+	};
+
+
+	/// where one side of a ring sleeps until the other one has made progress; the consumer side may be shared by
+	/// several rings that one thread drains
+	class Doorbell {
+	protected:
+		static constexpr size_t SpinCount = 1024;
+
+	protected:
+		std::atomic_bool m_isWaiting{ false };
+		std::atomic_uint32_t m_signal{ 0 };
+
+	public:
+		/// waits until isReady() or isClosed(), false when closed and still not ready
+		template <typename T_isReady, typename T_isClosed>
+		bool wait( t_waitStrategy strategy, T_isReady && isReady, T_isClosed && isClosed )
+		{
+			for ( size_t i = 0; !isReady(); ++i ) {
+				if ( isClosed() ) {
+					return isReady();
+				}
+
+				if ( t_waitStrategy::Spin == strategy || i < SpinCount ) {
+					continue;
+				}
+
+				if ( t_waitStrategy::Yield == strategy ) {
+					std::this_thread::yield();
+					continue;
+				}
+
+				auto observed = m_signal.load();
+				m_isWaiting.store( true );
+
+				if ( !isReady() && !isClosed() ) {
+					m_signal.wait( observed );
+				}
+
+				m_isWaiting.store( false );
+			}
+
+			return true;
+		}
+
+
+		/// the sleeper is woken only when it announced itself, the common path stays syscall free
+		void ring()
+		{
+			if ( m_isWaiting.load() ) {
+				m_signal.fetch_add( 1 );
+				m_signal.notify_one();
+			}
+		}
+
+
+		void ringAll()
+		{
+			m_signal.fetch_add( 1 );
+			m_signal.notify_all();
+		}
+	};
+
+
+	/// bounded single producer / single consumer queue, capacity is rounded up to a power of two
+	template <typename T> class SpscRing {
+	protected:
+		static constexpr size_t CacheLineSize = 64;
+
+	protected:
+		const size_t m_mask;
+		std::unique_ptr<std::optional<T>[]> m_slots;
+		const t_waitStrategy m_waitStrategy;
+
+		Doorbell m_producerBell;
+		Doorbell m_ownConsumerBell;
+		Doorbell * m_consumerBell;
+
+		/// written by the consumer
+		alignas( CacheLineSize ) std::atomic_size_t m_head{ 0 };
+
+		/// written by the producer
+		alignas( CacheLineSize ) std::atomic_size_t m_tail{ 0 };
+
+		std::atomic_bool m_isClosed{ false };
+
+		/// private to each side
+		alignas( CacheLineSize ) size_t m_cachedHead = 0;
+		alignas( CacheLineSize ) size_t m_cachedTail = 0;
+
+	protected:
+		static size_t roundUp( size_t n )
+		{
+			size_t out = 2;
+
+			while ( out < n ) {
+				out <<= 1;
+			}
+
+			return out;
+		}
+
+
+		/// a sleeping side has to see the index store before the other side reads its flag
+		std::memory_order publishOrder() const
+		{
+			return t_waitStrategy::Futex == m_waitStrategy ? std::memory_order_seq_cst : std::memory_order_release;
+		}
+
+	public:
+		/// consumerBell: shared by the rings one consumer drains, the ring has its own when null
+		SpscRing(
+			size_t capacity, t_waitStrategy waitStrategy = t_waitStrategy::Futex, Doorbell * consumerBell = nullptr )
+			: m_mask( roundUp( capacity ) - 1 )
+			, m_slots( new std::optional<T>[m_mask + 1] )
+			, m_waitStrategy( waitStrategy )
+			, m_consumerBell( consumerBell != nullptr ? consumerBell : &m_ownConsumerBell )
+		{
+		}
+
+
+		SpscRing( const SpscRing & ) = delete;
+		SpscRing & operator=( const SpscRing & ) = delete;
+
+
+		size_t Capacity() const
+		{
+			return m_mask + 1;
+		}
+
+
+		/// exact on the producer side, a lower bound of what is left on the consumer side
+		size_t Size() const
+		{
+			return m_tail.load( std::memory_order_acquire ) - m_head.load( std::memory_order_acquire );
+		}
+
+
+		bool IsEmpty() const
+		{
+			return m_tail.load() == m_head.load( std::memory_order_relaxed );
+		}
+
+
+		bool IsClosed() const
+		{
+			return m_isClosed;
+		}
+
+
+		/// producer side, false when the ring is full
+		bool tryPush( T && v )
+		{
+			auto tail = m_tail.load( std::memory_order_relaxed );
+
+			if ( tail - m_cachedHead > m_mask ) {
+				m_cachedHead = m_head.load( std::memory_order_acquire );
+
+				if ( tail - m_cachedHead > m_mask ) {
+					return false;
+				}
+			}
+
+			m_slots[tail & m_mask].emplace( std::move( v ) );
+			m_tail.store( tail + 1, publishOrder() );
+
+			if ( t_waitStrategy::Futex == m_waitStrategy ) {
+				m_consumerBell->ring();
+			}
+
+			return true;
+		}
+
+
+		/// producer side, waits for a free slot, false once the ring is closed
+		bool push( T && v )
+		{
+			auto tail = m_tail.load( std::memory_order_relaxed );
+
+			auto isFree = [this, tail] { return tail - m_head.load() <= m_mask; };
+			auto isClosed = [this] { return m_isClosed.load(); };
+
+			if ( !m_producerBell.wait( m_waitStrategy, isFree, isClosed ) ) {
+				return false;
+			}
+
+			return !m_isClosed && tryPush( std::move( v ) );
+		}
+
+
+		/// consumer side, false when the ring is empty
+		bool tryPop( T & v )
+		{
+			auto head = m_head.load( std::memory_order_relaxed );
+
+			if ( head == m_cachedTail ) {
+				m_cachedTail = m_tail.load( std::memory_order_acquire );
+
+				if ( head == m_cachedTail ) {
+					return false;
+				}
+			}
+
+			auto & slot = m_slots[head & m_mask];
+			v = std::move( *slot );
+			slot.reset();
+
+			m_head.store( head + 1, publishOrder() );
+
+			if ( t_waitStrategy::Futex == m_waitStrategy ) {
+				m_producerBell.ring();
+			}
+
+			return true;
+		}
+
+
+		/// consumer side, waits for an item, false once the ring is closed and drained
+		bool pop( T & v )
+		{
+			auto isAvailable = [this] { return !IsEmpty(); };
+			auto isClosed = [this] { return m_isClosed.load(); };
+
+			if ( !m_consumerBell->wait( m_waitStrategy, isAvailable, isClosed ) ) {
+				return false;
+			}
+
+			return tryPop( v );
+		}
+
+
+		/// wakes both sides, pop() still drains what was pushed before
+		void close()
+		{
+			m_isClosed = true;
+
+			m_producerBell.ringAll();
+			m_consumerBell->ringAll();
+		}
+	};
+
+} // namespace as
+
+
+#endif
@@ -0,0 +1,229 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// subscription.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__SUBSCRIPTION__H
+#define __CENTRIFUGEPP__SUBSCRIPTION__H
+
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <optional>
+#include <exception>
+#include <coroutine>
+#include <string_view>
+
+#include "core.hpp"
+#include "logger.hpp"
+#include "bufferPool.hpp"
+#include "channelRegistry.hpp"
+
+
+namespace as {
+
+	struct t_streamItem {
+		t_channelId channelId = ChannelRegistry::InvalidId;
+		/// the interned name, valid as long as the client
+		std::string_view channel;
+		SharedBuffer data;
+	};
+
+
+	/// detached coroutine: starts at once, frees itself once done; an escaping exception is logged
+	struct Task {
+		struct promise_type {
+			Task get_return_object()
+			{
+				return {};
+			}
+
+
+			std::suspend_never initial_suspend() noexcept
+			{
+				return {};
+			}
+
+
+			std::suspend_never final_suspend() noexcept
+			{
+				return {};
+			}
+
+
+			void return_void()
+			{
+			}
+
+
+			void unhandled_exception()
+			{
+				try {
+					throw;
+				}
+				catch ( const std::exception & x ) {
+					AS_LOG_ERROR_LINE( x.what() );
+				}
+			}
+		};
+	};
+
+
+	/// publications of the channels matching a pattern, taken one at a time by a coroutine:
+	///
+	///		while ( auto pub = co_await sub.next() ) { ... }
+	///
+	/// fed on the io thread, so with t_deliveryOptions::consumers = 0 only; a waiting coroutine is resumed right from
+	/// the read handler and runs there. Up to Capacity() publications wait while the coroutine is suspended on
+	/// something else, the oldest are dropped beyond that. One coroutine at a time
+	class Subscription {
+	protected:
+		std::vector<t_streamItem> m_items;
+		size_t m_head = 0;
+		size_t m_size = 0;
+		size_t m_droppedCount = 0;
+		bool m_isClosed = false;
+
+		std::coroutine_handle<> m_waiter;
+
+	protected:
+		struct t_awaiter {
+			Subscription & sub;
+
+
+			bool await_ready() const noexcept
+			{
+				return sub.m_size > 0 || sub.m_isClosed;
+			}
+
+
+			void await_suspend( std::coroutine_handle<> h ) noexcept
+			{
+				sub.m_waiter = h;
+			}
+
+
+			/// empty once closed and drained
+			std::optional<t_streamItem> await_resume()
+			{
+				if ( 0 == sub.m_size ) {
+					return std::nullopt;
+				}
+
+				return sub.pop();
+			}
+		};
+
+	protected:
+		t_streamItem pop()
+		{
+			auto item = std::move( m_items[m_head] );
+			m_head = ( m_head + 1 ) % m_items.size();
+			--m_size;
+
+			return item;
+		}
+
+
+		void wake()
+		{
+			if ( m_waiter ) {
+				std::exchange( m_waiter, {} ).resume();
+			}
+		}
+
+	public:
+		explicit Subscription( size_t capacity )
+			: m_items( std::max<size_t>( capacity, 1 ) )
+		{
+		}
+
+
+		Subscription( const Subscription & ) = delete;
+		Subscription & operator=( const Subscription & ) = delete;
+
+
+		size_t Capacity() const
+		{
+			return m_items.size();
+		}
+
+
+		size_t Size() const
+		{
+			return m_size;
+		}
+
+
+		/// publications dropped because the queue was full
+		size_t DroppedCount() const
+		{
+			return m_droppedCount;
+		}
+
+
+		bool IsClosed() const
+		{
+			return m_isClosed;
+		}
+
+
+		/// co_await: the next publication, empty once the client has stopped
+		t_awaiter next()
+		{
+			return { *this };
+		}
+
+
+		void push( t_streamItem && item )
+		{
+			if ( m_isClosed ) {
+				return;
+			}
+
+			if ( m_size == m_items.size() ) {
+				pop();
+				++m_droppedCount;
+			}
+
+			m_items[( m_head + m_size ) % m_items.size()] = std::move( item );
+			++m_size;
+
+			wake();
+		}
+
+
+		/// what is queued can still be taken, then next() yields nothing
+		void close()
+		{
+			m_isClosed = true;
+			wake();
+		}
+	};
+
+} // namespace as
+
+
+#endif
@@ -0,0 +1,133 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// tlsSessionCache.hpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#ifndef __CENTRIFUGEPP__TLS_SESSION_CACHE__H
+#define __CENTRIFUGEPP__TLS_SESSION_CACHE__H
+
+
+#include <mutex>
+#include <unordered_map>
+
+#include "openssl/ssl.h"
+
+#include "core.hpp"
+
+
+namespace as {
+
+	/// client side TLS sessions by "host:port", shared by all connections of the process
+	///
+	/// only copies are handed to connections: OpenSSL marks the session of a connection that was not shut down
+	/// cleanly as not resumable, that must not affect the cached one
+	class TlsSessionCache {
+	protected:
+		std::mutex m_sync;
+		std::unordered_map<t_string, SSL_SESSION *> m_sessions;
+
+	public:
+		TlsSessionCache() = default;
+		TlsSessionCache( const TlsSessionCache & ) = delete;
+		TlsSessionCache & operator=( const TlsSessionCache & ) = delete;
+
+
+		~TlsSessionCache()
+		{
+			for ( auto & p : m_sessions ) {
+				SSL_SESSION_free( p.second );
+			}
+		}
+
+
+		static TlsSessionCache & instance()
+		{
+			static TlsSessionCache cache;
+			return cache;
+		}
+
+
+		void put( const t_string & key, SSL_SESSION * session )
+		{
+			session = SSL_SESSION_dup( session );
+
+			if ( nullptr == session ) {
+				return;
+			}
+
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			auto & slot = m_sessions[key];
+
+			if ( slot != nullptr ) {
+				SSL_SESSION_free( slot );
+			}
+
+			slot = session;
+		}
+
+
+		/// offers the cached session for the next handshake of ssl
+		bool apply( const t_string & key, SSL * ssl )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			auto it = m_sessions.find( key );
+
+			if ( m_sessions.end() == it ) {
+				return false;
+			}
+
+			auto session = SSL_SESSION_dup( it->second );
+
+			if ( nullptr == session ) {
+				return false;
+			}
+
+			auto isSet = SSL_set_session( ssl, session ) == 1;
+			SSL_SESSION_free( session );
+
+			return isSet;
+		}
+
+
+		void erase( const t_string & key )
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			auto it = m_sessions.find( key );
+
+			if ( m_sessions.end() == it ) {
+				return;
+			}
+
+			SSL_SESSION_free( it->second );
+			m_sessions.erase( it );
+		}
+	};
+
+} // namespace as
+
+
+#endif
@@ -41,6 +41,7 @@ namespace as {
 		t_string m_scheme;
 		t_string m_hostname;
 		t_string m_path;
+		t_string m_socketPath;
 		uint16_t m_port;
 
 	protected:
@@ -75,12 +76,29 @@ namespace as {
 		}
 
 
+		/// ws+unix://<socket path>[:<request path>], e.g. ws+unix:///run/centrifugo.sock:/connection/websocket
+		static void parseUnix( Url & out, const t_stringview & s )
+		{
+			auto tokenStart = s.find( AS_T( "//" ) ) + 2;
+			auto tokenEnd = s.find( AS_T( ':' ), tokenStart );
+
+			out.m_socketPath = s.substr( tokenStart, tokenEnd - tokenStart );
+			out.m_hostname = AS_T( "localhost" );
+			out.m_path = t_string::npos == tokenEnd ? AS_T( "/" ) : t_string( s.substr( tokenEnd + 1 ) );
+		}
+
+
 		static void parse( Url & out, const t_stringview & s )
 		{
 			out.m_uri = s;
 
 			out.m_scheme = s.substr( 0, s.find( AS_T( ':' ) ) );
 
+			if ( out.IsUnix() ) {
+				parseUnix( out, s );
+				return;
+			}
+
 			auto tokenStart = s.find( AS_T( "//" ) );
 			auto tokenEnd = s.find( AS_T( "/" ), tokenStart + 2 );
 
@@ -176,6 +194,18 @@ namespace as {
 		{
 			return m_port;
 		}
+
+
+		constexpr const t_string & SocketPath() const
+		{
+			return m_socketPath;
+		}
+
+
+		bool IsUnix() const
+		{
+			return AS_T( "ws+unix" ) == m_scheme;
+		}
 	};
 
 } // namespace as
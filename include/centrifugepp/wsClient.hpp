@@ -29,12 +29,18 @@
 
 
 #include <mutex>
+#include <memory>
 #include <atomic>
 #include <thread>
+#include <optional>
+#include <variant>
+#include <functional>
 #include <string_view>
 
 #include "boost/asio/connect.hpp"
 #include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/local/stream_protocol.hpp"
+#include "boost/asio/steady_timer.hpp"
 #include "boost/asio/ssl/stream.hpp"
 
 #include "boost/beast/core.hpp"
@@ -44,23 +50,122 @@
 #include "core.hpp"
 #include "logger.hpp"
 #include "url.hpp"
+#include "tlsSessionCache.hpp"
+#include "resolverCache.hpp"
 
 
 namespace as {
 
-	using t_wsStream = boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>;
+	using t_wssStream = boost::beast::websocket::stream<boost::asio::ssl::stream<boost::asio::ip::tcp::socket>>;
+	using t_wsTcpStream = boost::beast::websocket::stream<boost::asio::ip::tcp::socket>;
+
+#if defined( SSL_OP_ENABLE_KTLS ) && !defined( _WIN32 )
+#define AS_HAS_KTLS
+#endif
+
+
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+	using t_wsUnixStream = boost::beast::websocket::stream<boost::asio::local::stream_protocol::socket>;
+
+	/// picked by the url scheme: wss/https over TLS, ws/http over plain TCP, ws+unix over a unix domain socket
+	using t_wsStream = std::variant<t_wssStream, t_wsTcpStream, t_wsUnixStream>;
+#else
+	/// picked by the url scheme: wss/https over TLS, ws/http over plain TCP
+	using t_wsStream = std::variant<t_wssStream, t_wsTcpStream>;
+#endif
+
+
+	/// applied to the TCP socket once it is connected, 0 keeps the OS default
+	///
+	/// options the platform does not define are skipped
+	struct t_socketOptions {
+		bool isNoDelay = true;
+		int receiveBufferSize = 0;
+		int sendBufferSize = 0;
+		/// SO_BUSY_POLL, microseconds to spin on the device queue in blocking reads
+		int busyPollUs = 0;
+		/// TCP_QUICKACK is not sticky, it is set again before every read
+		bool isQuickAck = false;
+		/// keepalive is enabled when the idle time is set
+		int keepAliveIdleS = 0;
+		int keepAliveIntervalS = 0;
+		int keepAliveCount = 0;
+		/// TCP_USER_TIMEOUT, the connection fails once sent data stays unacknowledged this long
+		unsigned userTimeoutMs = 0;
+	};
+
+
+	/// how run() waits for the io context
+	enum class t_runMode {
+		/// sleeps in the reactor until there is work
+		Blocking,
+		/// spins on poll(), the next read is picked up without a wakeup; burns the core
+		Spin,
+	};
+
+
+	/// own io context only, a shared one is driven by its owner
+	struct t_runOptions {
+		t_runMode mode = t_runMode::Blocking;
+		/// Spin: cpu pause instructions after a poll that found nothing, eases the core's sibling and the power draw
+		size_t pauseCount = 0;
+		/// Spin: blocks for the next handler once nothing has been done for this long, 0 - never
+		t_timespan idleUs = 0;
+		/// the io thread is pinned to this cpu while it runs, -1 - not pinned
+		int cpu = -1;
+	};
+
+
+	/// where a spinning io thread spent its time, accumulated over the connections of a client
+	struct t_spinStats {
+		size_t polls = 0;
+		size_t idlePolls = 0;
+		/// in polls that ran handlers
+		int64_t workNs = 0;
+		/// in polls that found nothing and the pauses after them
+		int64_t spinNs = 0;
+		/// blocked after idleUs, the handler that ended it included
+		int64_t sleepNs = 0;
+	};
+
+
+	struct t_wsOptions {
+		/// permessage-deflate offer, off unless client_enable is set
+		boost::beast::websocket::permessage_deflate deflate;
+		t_socketOptions socket;
+		/// wss: let the kernel encrypt and decrypt the TLS records (OpenSSL 3 built with kTLS, tls module loaded);
+		/// such connections are capped at TLS 1.2, a client falls back to userspace TLS when the kernel does not take
+		/// both directions or a read fails on a record it does not pass through
+		bool isKtls = false;
+		t_runOptions run;
+	};
 
 
 	class WsClientBase {
 	protected:
 		t_timespan m_watchdogTimeoutMs = 15 * 1000;
+		t_wsOptions m_options;
 
 		Url m_url;
+		bool m_isTls;
 
-		boost::asio::io_context m_io;
+		/// null when the io context is shared with other connections
+		std::unique_ptr<boost::asio::io_context> m_ownIo;
+		boost::asio::io_context & m_io;
 		boost::asio::ssl::context m_ctx;
 
-		t_wsStream m_stream;
+		std::optional<t_wsStream> m_stream;
+
+		boost::asio::ip::tcp::resolver m_resolver;
+		ResolverCache::t_endpoints m_endpoints;
+		t_string m_endpointKey;
+
+		std::vector<std::unique_ptr<boost::asio::ip::tcp::socket>> m_connectAttempts;
+		boost::asio::steady_timer m_connectAttemptTimer;
+		t_timespan m_connectAttemptDelayMs = 250;
+		size_t m_connectGeneration = 0;
+		size_t m_nextEndpoint = 0;
+		size_t m_pendingConnectAttempts = 0;
 
 		std::mutex m_streamWriteSync;
 		std::mutex m_streamPingSync;
@@ -69,11 +174,35 @@ namespace as {
 
 		std::atomic_int64_t m_lastActivityTs;
 
-		std::thread m_watchdogThread;
-		std::atomic_flag m_isWatchdogActive;
+		std::atomic_bool m_isReadPaused{ false };
+		size_t m_readPauseCount = 0;
+
+		boost::asio::steady_timer m_watchdogTimer;
+		boost::asio::steady_timer m_deferTimer;
+
+		/// operations started and not completed yet; on a shared io context a stopped connection is reported only
+		/// once there are none left, its stream goes away only then
+		std::atomic_size_t m_pendingOps{ 0 };
+		std::atomic_bool m_isStopping{ false };
+		std::function<void()> m_stoppedHandler;
 
 		t_string m_id;
 
+		bool m_isTlsSessionResumption = true;
+		size_t m_tlsHandshakeCount = 0;
+		size_t m_tlsResumedCount = 0;
+
+		std::unique_ptr<SSL, void ( * )( SSL * )> m_ktlsSsl{ nullptr, &SSL_free };
+		/// kTLS did not work out for this client, its next connections use userspace TLS
+		bool m_isKtlsFailed = false;
+
+		/// written by the io thread only
+		std::atomic_size_t m_pollCount{ 0 };
+		std::atomic_size_t m_idlePollCount{ 0 };
+		std::atomic_int64_t m_workNs{ 0 };
+		std::atomic_int64_t m_spinNs{ 0 };
+		std::atomic_int64_t m_sleepNs{ 0 };
+
 	protected:
 		static auto NowTs()
 		{
@@ -89,11 +218,63 @@ namespace as {
 		}
 
 
+		template <typename T_func> decltype( auto ) visitStream( T_func && f )
+		{
+			return std::visit( std::forward<T_func>( f ), *m_stream );
+		}
+
+
+		/// wraps a completion handler into one that counts as pending until it has run
+		template <typename T_handler> auto tracked( T_handler && handler )
+		{
+			++m_pendingOps;
+
+			return [this, h = std::forward<T_handler>( handler )]( auto &&... args ) mutable {
+				h( std::forward<decltype( args )>( args )... );
+
+				--m_pendingOps;
+				completeStop();
+			};
+		}
+
+
+		SSL * tlsHandle()
+		{
+			return m_ktlsSsl ? m_ktlsSsl.get() : std::get<t_wssStream>( *m_stream ).next_layer().native_handle();
+		}
+
+
+		void resetStream();
+		void emplaceStream();
+		void spin();
+		void shutdown();
+		void completeStop();
+		void watchdogAsync();
+
+		void resolveAsync();
+		void connectUnixAsync();
+		void connectAsync( const boost::asio::ip::tcp::resolver::results_type & results );
+		void connectAsync();
+		void connectNextAsync();
+		void OnConnectAttempt( boost::system::error_code ec, size_t generation, size_t index );
+
+		void applySocketOptions( boost::asio::ip::tcp::socket & socket );
+		void rearmQuickAck();
+
+		void offerTlsSession();
+		void countTlsHandshake( bool isSuccessful );
+
+		bool isKtlsEnabled() const;
+		void ktlsHandshakeAsync();
+		void ktlsHandshakeStep();
+
+		static int OnNewTlsSession( SSL * ssl, SSL_SESSION * session );
+
+
 		virtual void OnResolve(
 			boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type results ) = 0;
 
-		virtual void OnConnect(
-			boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type::iterator it ) = 0;
+		virtual void OnConnect( boost::system::error_code ec ) = 0;
 
 		virtual void OnSslHandshake( boost::system::error_code ec ) = 0;
 		virtual void OnHandshake( boost::system::error_code ec ) = 0;
@@ -104,24 +285,27 @@ namespace as {
 		virtual void OnClose( boost::system::error_code ec ) = 0;
 
 	public:
-		WsClientBase( const Url & url )
+		/// io: shared with other connections and run by the caller, start() instead of run(); null - an own one
+		WsClientBase( const Url & url, boost::asio::io_context * io = nullptr )
 			: m_url( url )
+			, m_isTls( AS_T( "wss" ) == url.Scheme() || AS_T( "https" ) == url.Scheme() )
+			, m_ownIo( nullptr == io ? new boost::asio::io_context : nullptr )
+			, m_io( nullptr == io ? *m_ownIo : *io )
 			, m_ctx( boost::asio::ssl::context::method::tls_client )
-			, m_stream( m_io, m_ctx )
+			, m_resolver( m_io )
+			, m_endpointKey( url.Hostname() + ':' + std::to_string( url.Port() ) )
+			, m_connectAttemptTimer( m_io )
+			, m_watchdogTimer( m_io )
+			, m_deferTimer( m_io )
 		{
 
-			m_stream.binary( true );
+			SSL_CTX_set_session_cache_mode(
+				m_ctx.native_handle(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE );
+			SSL_CTX_sess_set_new_cb( m_ctx.native_handle(), &WsClientBase::OnNewTlsSession );
 		}
 
 
-		virtual ~WsClientBase()
-		{
-			m_isWatchdogActive.clear();
-
-			if ( m_watchdogThread.joinable() ) {
-				m_watchdogThread.join();
-			}
-		}
+		virtual ~WsClientBase() = default;
 
 
 		void WatchdogTimeoutMs( t_timespan t )
@@ -132,9 +316,52 @@ namespace as {
 		}
 
 
+		/// takes effect with the next connection
+		void Options( const t_wsOptions & options )
+		{
+			m_options = options;
+		}
+
+
 		bool IsOpen() const
 		{
-			return m_stream.is_open();
+			return m_stream && std::visit( []( const auto & stream ) { return stream.is_open(); }, *m_stream );
+		}
+
+
+		bool IsTls() const
+		{
+			return m_isTls;
+		}
+
+
+		/// the socket of the current connection for an outside event loop to watch, changes with every connection;
+		/// -1 while there is none
+		int64_t NativeHandle() const
+		{
+			if ( !m_stream ) {
+				return -1;
+			}
+
+			// native_handle() is not const in asio
+			return std::visit(
+				[]( auto & stream ) {
+					auto & socket = boost::beast::get_lowest_layer( stream );
+					return socket.is_open() ? static_cast<int64_t>( socket.native_handle() ) : int64_t( -1 );
+				},
+				const_cast<t_wsStream &>( *m_stream ) );
+		}
+
+
+		boost::asio::io_context & Io()
+		{
+			return m_io;
+		}
+
+
+		bool IsSharedIo() const
+		{
+			return !m_ownIo;
 		}
 
 
@@ -150,8 +377,87 @@ namespace as {
 		}
 
 
+		/// delay before the next endpoint is tried in parallel with the pending ones
+		void ConnectAttemptDelayMs( t_timespan t )
+		{
+			m_connectAttemptDelayMs = t;
+		}
+
+
+		void TlsSessionResumption( bool v )
+		{
+			m_isTlsSessionResumption = v;
+		}
+
+
+		/// io thread only, typically from the read handler: the read that completes is not followed by another one
+		/// until resumeRead(), so TCP flow control pushes back on the server; the watchdog ignores a paused
+		/// connection. Pings are not read either: a pause longer than the server ping interval plus its pong
+		/// timeout (25 + 8 s by default for Centrifugo) gets the connection closed by the server
+		void pauseRead()
+		{
+			if ( !m_isReadPaused.exchange( true ) ) {
+				++m_readPauseCount;
+			}
+		}
+
+
+		bool IsReadPaused() const
+		{
+			return m_isReadPaused;
+		}
+
+
+		size_t ReadPauseCount() const
+		{
+			return m_readPauseCount;
+		}
+
+
+		/// the current connection runs over kernel TLS
+		bool IsKtls() const
+		{
+			return m_ktlsSsl != nullptr;
+		}
+
+
+		size_t TlsHandshakeCount() const
+		{
+			return m_tlsHandshakeCount;
+		}
+
+
+		size_t TlsResumedCount() const
+		{
+			return m_tlsResumedCount;
+		}
+
+
+		/// t_runMode::Spin, any thread
+		t_spinStats SpinStats() const
+		{
+			return { m_pollCount.load( std::memory_order_relaxed ),
+				m_idlePollCount.load( std::memory_order_relaxed ),
+				m_workNs.load( std::memory_order_relaxed ),
+				m_spinNs.load( std::memory_order_relaxed ),
+				m_sleepNs.load( std::memory_order_relaxed ) };
+		}
+
+
+		/// share of TLS handshakes that resumed a cached session
+		double TlsResumptionRate() const
+		{
+			return 0 == m_tlsHandshakeCount ? 0.0
+											: static_cast<double>( m_tlsResumedCount ) / m_tlsHandshakeCount;
+		}
+
+
 		void run();
+		void start( std::function<void()> && stoppedHandler );
+		void stop();
 		void readAsync();
+		void resumeRead();
+		void deferAsync( t_timespan us, std::function<void()> && handler );
 		bool write( const void * data, size_t size );
 		void writeAsync( const void * data, size_t size );
 		void pingAsync( const void * data, size_t size );
@@ -166,62 +472,96 @@ namespace as {
 		T_readHandler m_readHandler;
 
 	protected:
+		void OnError( boost::system::error_code ec )
+		{
+			// the operations a stop aborts
+			if ( m_isStopping ) {
+				return;
+			}
+
+			m_errorHandler( *this, ec.value(), ec.message() );
+			stop();
+		}
+
+
 		void OnResolve( boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type results ) override
 		{
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 
-			boost::asio::async_connect( m_stream.next_layer().next_layer(),
-				results.begin(),
-				results.end(),
-				std::bind( &WsClient::OnConnect, this, std::placeholders::_1, std::placeholders::_2 ) );
+			connectAsync( results );
 		}
 
 
-		void OnConnect(
-			boost::system::error_code ec, boost::asio::ip::tcp::resolver::results_type::iterator it ) override
+		void OnConnect( boost::system::error_code ec ) override
 		{
 
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 
-			SSL_set_tlsext_host_name( m_stream.next_layer().native_handle(), m_url.Hostname().c_str() );
+			if ( !m_isTls ) {
+				handshakeAsync();
+				return;
+			}
 
-			m_stream.next_layer().async_handshake( boost::asio::ssl::stream_base::client,
-				std::bind( &WsClient::OnSslHandshake, this, std::placeholders::_1 ) );
+			if ( isKtlsEnabled() ) {
+				ktlsHandshakeAsync();
+				return;
+			}
+
+			SSL_set_tlsext_host_name( tlsHandle(), m_url.Hostname().c_str() );
+			offerTlsSession();
+
+			std::get<t_wssStream>( *m_stream )
+				.next_layer()
+				.async_handshake( boost::asio::ssl::stream_base::client,
+					tracked( std::bind( &WsClient::OnSslHandshake, this, std::placeholders::_1 ) ) );
 		}
 
 
 		void OnSslHandshake( boost::system::error_code ec ) override
 		{
+			countTlsHandshake( !ec );
+
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 
-			m_stream.set_option(
-				boost::beast::websocket::stream_base::decorator( []( boost::beast::websocket::request_type & req ) {
-					req.set( boost::beast::http::field::sec_websocket_protocol, "centrifuge-protobuf" );
-				} ) );
+			handshakeAsync();
+		}
+
 
-			m_stream.async_handshake(
-				m_url.Hostname(), m_url.Path(), std::bind( &WsClient::OnHandshake, this, std::placeholders::_1 ) );
+		void handshakeAsync()
+		{
+			visitStream( [this]( auto & stream ) {
+				stream.set_option( boost::beast::websocket::stream_base::decorator(
+					[]( boost::beast::websocket::request_type & req ) {
+						req.set( boost::beast::http::field::sec_websocket_protocol, "centrifuge-protobuf" );
+					} ) );
+
+				stream.async_handshake( m_url.Hostname(),
+					m_url.Path(),
+					tracked( std::bind( &WsClient::OnHandshake, this, std::placeholders::_1 ) ) );
+			} );
 		}
 
 
 		void OnHandshake( boost::system::error_code ec ) override
 		{
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 
-			m_stream.control_callback(
-				std::bind( &WsClient::OnControl, this, std::placeholders::_1, std::placeholders::_2 ) );
+			visitStream( [this]( auto & stream ) {
+				stream.control_callback(
+					std::bind( &WsClient::OnControl, this, std::placeholders::_1, std::placeholders::_2 ) );
+			} );
 
 			m_handshakeHandler( *this );
 		}
@@ -232,7 +572,7 @@ namespace as {
 			boost::ignore_unused( bytesWritten );
 
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 		}
@@ -241,7 +581,13 @@ namespace as {
 		void OnReadComplete( boost::system::error_code ec, std::size_t bytesRead ) override
 		{
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				// a kTLS socket fails the read on a record other than application data, an alert or a renegotiation
+				if ( IsKtls() && boost::system::errc::io_error == ec ) {
+					AS_LOG_WARN_LINE( "kTLS read failed, reconnecting over userspace TLS" );
+					m_isKtlsFailed = true;
+				}
+
+				OnError( ec );
 				return;
 			}
 
@@ -259,6 +605,10 @@ namespace as {
 
 			m_buffer.consume( bytesRead );
 
+			if ( m_isReadPaused ) {
+				return;
+			}
+
 			readAsync();
 		}
 
@@ -266,7 +616,7 @@ namespace as {
 		void OnPingComplete( boost::system::error_code ec ) override
 		{
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 		}
@@ -275,7 +625,7 @@ namespace as {
 		void OnClose( boost::system::error_code ec ) override
 		{
 			if ( ec ) {
-				m_errorHandler( *this, ec.value(), ec.message() );
+				OnError( ec );
 				return;
 			}
 		}
@@ -283,12 +633,15 @@ namespace as {
 
 		void OnControl( boost::beast::websocket::frame_type type, boost::beast::string_view payload ) override
 		{
+			boost::ignore_unused( payload );
 			AS_LOG_TRACE_LINE( payload );
 
 			refreshLastActivityTs();
 
 			if ( boost::beast::websocket::frame_type::ping == type ) {
-				m_stream.async_pong( "as::wsClient", []( boost::system::error_code ) {} );
+				visitStream( [this]( auto & stream ) {
+					stream.async_pong( "as::wsClient", tracked( []( boost::system::error_code ) {} ) );
+				} );
 			}
 		}
 
@@ -296,8 +649,9 @@ namespace as {
 		WsClient( const Url & url,
 			const T_errorHandler & errorHandler,
 			const T_handshakeHandler & handshakeHandler,
-			const T_readHandler & readHandler )
-			: WsClientBase( url )
+			const T_readHandler & readHandler,
+			boost::asio::io_context * io = nullptr )
+			: WsClientBase( url, io )
 			, m_errorHandler( errorHandler )
 			, m_handshakeHandler( handshakeHandler )
 			, m_readHandler( readHandler )
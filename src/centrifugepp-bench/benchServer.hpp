@@ -0,0 +1,468 @@
+﻿#ifndef __CENTRIFUGEPP_BENCH__BENCH_SERVER__H
+#define __CENTRIFUGEPP_BENCH__BENCH_SERVER__H
+
+
+#include <list>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <optional>
+#include <type_traits>
+
+#include "openssl/ec.h"
+#include "openssl/x509.h"
+
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/local/stream_protocol.hpp"
+#include "boost/asio/ssl.hpp"
+#include "boost/asio/steady_timer.hpp"
+
+#include "boost/beast/core.hpp"
+#include "boost/beast/websocket.hpp"
+#include "boost/beast/websocket/ssl.hpp"
+
+#include "protocol/client.pb.h"
+
+#include "centrifugepp/centrifugeClient.hpp"
+
+
+namespace bench {
+
+	namespace protocol = centrifugal::centrifuge::protocol;
+
+
+	struct t_serverOptions {
+		/// publications per connection
+		size_t count = 100000;
+		/// payload bytes, the first 8 carry the send time
+		size_t size = 256;
+		/// replies per websocket frame
+		size_t batch = 16;
+		/// pause between frames, 0 - as fast as the connection takes them
+		as::t_timespan intervalUs = 0;
+		/// publishing starts this long after the last subscribe command
+		as::t_timespan startDelayMs = 100;
+		/// accepted permessage-deflate parameters, off unless server_enable is set
+		boost::beast::websocket::permessage_deflate deflate;
+		/// caps TLS at 1.2, OpenSSL before 3.2 offloads only 1.2 receive to the kernel
+		bool isTls12 = false;
+	};
+
+
+	inline int64_t nowNs()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch() )
+			.count();
+	}
+
+
+	/// beast rate policy that only counts the bytes handed to the socket
+	class CountingPolicy {
+	protected:
+		friend class boost::beast::rate_policy_access;
+
+		std::atomic_size_t * m_bytesWritten;
+
+	protected:
+		size_t available_read_bytes() const noexcept
+		{
+			return std::numeric_limits<size_t>::max();
+		}
+
+
+		size_t available_write_bytes() const noexcept
+		{
+			return std::numeric_limits<size_t>::max();
+		}
+
+
+		void transfer_read_bytes( size_t ) noexcept
+		{
+		}
+
+
+		void transfer_write_bytes( size_t n ) noexcept
+		{
+			*m_bytesWritten += n;
+		}
+
+
+		void on_timer() noexcept
+		{
+		}
+
+	public:
+		explicit CountingPolicy( std::atomic_size_t & bytesWritten )
+			: m_bytesWritten( &bytesWritten )
+		{
+		}
+	};
+
+
+	template <typename T> struct IsSslStream : std::false_type {};
+	template <typename T> struct IsSslStream<boost::asio::ssl::stream<T>> : std::true_type {};
+
+
+	inline boost::asio::ssl::context makeTlsContext()
+	{
+		boost::asio::ssl::context ctx( boost::asio::ssl::context::tls_server );
+
+		EVP_PKEY * key = nullptr;
+		auto keyCtx = EVP_PKEY_CTX_new_id( EVP_PKEY_EC, nullptr );
+		EVP_PKEY_keygen_init( keyCtx );
+		EVP_PKEY_CTX_set_ec_paramgen_curve_nid( keyCtx, NID_X9_62_prime256v1 );
+		EVP_PKEY_keygen( keyCtx, &key );
+		EVP_PKEY_CTX_free( keyCtx );
+
+		auto cert = X509_new();
+		X509_set_version( cert, 2 );
+		ASN1_INTEGER_set( X509_get_serialNumber( cert ), 1 );
+		X509_gmtime_adj( X509_getm_notBefore( cert ), 0 );
+		X509_gmtime_adj( X509_getm_notAfter( cert ), 24 * 3600 );
+		X509_set_pubkey( cert, key );
+
+		auto name = X509_get_subject_name( cert );
+		X509_NAME_add_entry_by_txt(
+			name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char *>( "localhost" ), -1, -1, 0 );
+		X509_set_issuer_name( cert, name );
+		X509_sign( cert, key, EVP_sha256() );
+
+		SSL_CTX_use_certificate( ctx.native_handle(), cert );
+		SSL_CTX_use_PrivateKey( ctx.native_handle(), key );
+
+		X509_free( cert );
+		EVP_PKEY_free( key );
+
+		return ctx;
+	}
+
+
+	class BenchSessionBase {
+	public:
+		virtual ~BenchSessionBase() = default;
+		virtual void start() = 0;
+	};
+
+
+	/// answers connect/subscribe commands and pushes publications to the subscribed channels
+	template <typename T_stream> class BenchSession : public BenchSessionBase {
+	protected:
+		const t_serverOptions & m_options;
+
+		T_stream m_stream;
+		boost::beast::flat_buffer m_buffer;
+
+		boost::asio::steady_timer m_startTimer;
+		boost::asio::steady_timer m_paceTimer;
+
+		std::deque<std::string> m_queue;
+		bool m_isWriting = false;
+
+		std::vector<std::string> m_channels;
+		std::string m_payload;
+		size_t m_published = 0;
+		bool m_isPublishing = false;
+
+	protected:
+		void acceptAsync()
+		{
+			m_stream.binary( true );
+			m_stream.set_option( m_options.deflate );
+			m_stream.set_option( boost::beast::websocket::stream_base::decorator(
+				[]( boost::beast::websocket::response_type & res ) {
+					res.set( boost::beast::http::field::sec_websocket_protocol, "centrifuge-protobuf" );
+				} ) );
+
+			m_stream.async_accept( [this]( boost::system::error_code ec ) {
+				if ( !ec ) {
+					readAsync();
+				}
+			} );
+		}
+
+
+		void readAsync()
+		{
+			m_stream.async_read( m_buffer, [this]( boost::system::error_code ec, size_t ) {
+				if ( ec ) {
+					m_startTimer.cancel();
+					m_paceTimer.cancel();
+					return;
+				}
+
+				OnCommands( static_cast<const char *>( m_buffer.data().data() ), m_buffer.size() );
+				m_buffer.consume( m_buffer.size() );
+
+				readAsync();
+			} );
+		}
+
+
+		void OnCommands( const char * data, size_t size )
+		{
+			std::string frame;
+			as::t_buffer b( const_cast<char *>( data ), size );
+
+			while ( size > 0 ) {
+				auto s = as::CentrifugeClientBase::decodeLength( b );
+
+				protocol::Command command;
+				command.ParseFromArray( b.ptr + b.len, static_cast<int>( s ) );
+
+				size -= s + b.len;
+				b.ptr += s + b.len;
+				b.len = size;
+
+				protocol::Reply reply;
+				reply.set_id( command.id() );
+
+				if ( command.has_connect() ) {
+					reply.mutable_connect()->set_client( "bench" );
+				}
+				else if ( command.has_subscribe() ) {
+					reply.mutable_subscribe();
+					m_channels.push_back( command.subscribe().channel() );
+					startAsync();
+				}
+				else if ( command.has_unsubscribe() ) {
+					reply.mutable_unsubscribe();
+					std::erase( m_channels, command.unsubscribe().channel() );
+				}
+				else {
+					continue;
+				}
+
+				std::string message;
+				as::CentrifugeClientBase::serialize( message, reply );
+				frame += message;
+			}
+
+			if ( !frame.empty() ) {
+				send( std::move( frame ) );
+			}
+		}
+
+
+		void startAsync()
+		{
+			if ( m_isPublishing ) {
+				return;
+			}
+
+			m_startTimer.expires_after( std::chrono::milliseconds( m_options.startDelayMs ) );
+			m_startTimer.async_wait( [this]( boost::system::error_code ec ) {
+				if ( ec ) {
+					return;
+				}
+
+				m_isPublishing = true;
+				publishNext();
+			} );
+		}
+
+
+		void publishNext()
+		{
+			if ( m_published >= m_options.count || m_channels.empty() ) {
+				return;
+			}
+
+			std::string frame;
+			std::string message;
+			protocol::Reply reply;
+			auto push = reply.mutable_push();
+			auto pub = push->mutable_pub();
+
+			for ( size_t i = 0; i < m_options.batch && m_published < m_options.count; ++i, ++m_published ) {
+				const auto & channel = m_channels[m_published % m_channels.size()];
+
+				auto ts = nowNs();
+				std::memcpy( m_payload.data(), &ts, sizeof ts );
+
+				push->set_channel( channel );
+				pub->set_channel( channel );
+				pub->set_data( m_payload );
+
+				as::CentrifugeClientBase::serialize( message, reply );
+				frame += message;
+			}
+
+			send( std::move( frame ) );
+
+			if ( m_options.intervalUs > 0 ) {
+				m_paceTimer.expires_after( std::chrono::microseconds( m_options.intervalUs ) );
+				m_paceTimer.async_wait( [this]( boost::system::error_code ec ) {
+					if ( !ec ) {
+						publishNext();
+					}
+				} );
+			}
+		}
+
+
+		void send( std::string && frame )
+		{
+			m_queue.push_back( std::move( frame ) );
+
+			if ( !m_isWriting ) {
+				writeNext();
+			}
+		}
+
+
+		void writeNext()
+		{
+			if ( m_queue.empty() ) {
+				m_isWriting = false;
+
+				if ( m_isPublishing && 0 == m_options.intervalUs ) {
+					publishNext();
+				}
+
+				return;
+			}
+
+			m_isWriting = true;
+
+			m_stream.async_write(
+				boost::asio::buffer( m_queue.front() ), [this]( boost::system::error_code ec, size_t ) {
+					if ( ec ) {
+						return;
+					}
+
+					m_queue.pop_front();
+					writeNext();
+				} );
+		}
+
+	public:
+		template <typename... T_args>
+		BenchSession( const t_serverOptions & options, T_args &&... args )
+			: m_options( options )
+			, m_stream( std::forward<T_args>( args )... )
+			, m_startTimer( m_stream.get_executor() )
+			, m_paceTimer( m_stream.get_executor() )
+		{
+
+			static const std::string_view sample = R"({"price":12345.67,"qty":3,"side":"buy","id":1024},)";
+
+			m_payload.resize( std::max<size_t>( m_options.size, sizeof( int64_t ) ) );
+
+			for ( size_t i = 0; i < m_payload.size(); ++i ) {
+				m_payload[i] = sample[i % sample.size()];
+			}
+		}
+
+
+		void start() override
+		{
+			if constexpr ( IsSslStream<typename T_stream::next_layer_type>::value ) {
+				m_stream.next_layer().async_handshake(
+					boost::asio::ssl::stream_base::server, [this]( boost::system::error_code ec ) {
+						if ( !ec ) {
+							acceptAsync();
+						}
+					} );
+			}
+			else {
+				acceptAsync();
+			}
+		}
+	};
+
+
+	/// in-process stand-in for Centrifugo, runs on its own thread
+	template <typename T_protocol> class BenchServer {
+	protected:
+		using t_socket = typename T_protocol::socket;
+		using t_countingStream = boost::beast::basic_stream<T_protocol, boost::asio::any_io_executor, CountingPolicy>;
+
+	protected:
+		t_serverOptions m_options;
+		std::atomic_size_t m_bytesSent{ 0 };
+
+		boost::asio::io_context m_io;
+		typename T_protocol::acceptor m_acceptor;
+		std::optional<boost::asio::ssl::context> m_tls;
+
+		std::list<std::unique_ptr<BenchSessionBase>> m_sessions;
+		std::thread m_thread;
+
+	protected:
+		void acceptAsync()
+		{
+			m_acceptor.async_accept( [this]( boost::system::error_code ec, t_socket socket ) {
+				if ( ec ) {
+					return;
+				}
+
+				// as the client does; small replies would otherwise wait for the delayed ack of the previous one
+				if constexpr ( std::is_same_v<T_protocol, boost::asio::ip::tcp> ) {
+					socket.set_option( boost::asio::ip::tcp::no_delay( true ), ec );
+				}
+
+				t_countingStream counting( CountingPolicy( m_bytesSent ), std::move( socket ) );
+
+				if ( m_tls ) {
+					using t_stream = boost::beast::websocket::stream<boost::asio::ssl::stream<t_countingStream>>;
+					m_sessions.push_back(
+						std::make_unique<BenchSession<t_stream>>( m_options, std::move( counting ), *m_tls ) );
+				}
+				else {
+					using t_stream = boost::beast::websocket::stream<t_countingStream>;
+					m_sessions.push_back(
+						std::make_unique<BenchSession<t_stream>>( m_options, std::move( counting ) ) );
+				}
+
+				m_sessions.back()->start();
+
+				acceptAsync();
+			} );
+		}
+
+	public:
+		BenchServer( const typename T_protocol::endpoint & endpoint, const t_serverOptions & options, bool isTls )
+			: m_options( options )
+			, m_acceptor( m_io, endpoint )
+		{
+
+			if ( isTls ) {
+				m_tls.emplace( makeTlsContext() );
+
+				if ( m_options.isTls12 ) {
+					SSL_CTX_set_max_proto_version( m_tls->native_handle(), TLS1_2_VERSION );
+				}
+			}
+
+			acceptAsync();
+
+			m_thread = std::thread( [this] { m_io.run(); } );
+		}
+
+
+		~BenchServer()
+		{
+			m_io.stop();
+			m_thread.join();
+		}
+
+
+		typename T_protocol::endpoint Endpoint() const
+		{
+			return m_acceptor.local_endpoint();
+		}
+
+
+		/// bytes written to the sockets of all sessions, framing and TLS records included
+		size_t BytesSent() const
+		{
+			return m_bytesSent;
+		}
+	};
+
+} // namespace bench
+
+
+#endif
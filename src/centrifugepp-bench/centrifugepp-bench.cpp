@@ -0,0 +1,1751 @@
+﻿#include <iostream>
+#include <string_view>
+#include <vector>
+#include <array>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+#include <ctime>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#if defined( __linux__ )
+#include <unistd.h>
+#include <sys/epoll.h>
+#endif
+
+#include "centrifugepp/centrifugeClient.hpp"
+#include "centrifugepp/spscRing.hpp"
+#include "centrifugepp/engine.hpp"
+#include "centrifugepp/shardedClient.hpp"
+#include "centrifugepp/fanOut.hpp"
+
+#include "protocol/client.pb.h"
+
+#include "benchServer.hpp"
+#include "../centrifugepp-relay/relayServer.hpp"
+
+
+namespace {
+
+	std::atomic_size_t g_allocCount{ 0 };
+
+
+	using t_clock = std::chrono::steady_clock;
+
+
+	double elapsedUs( t_clock::time_point since )
+	{
+		return std::chrono::duration<double, std::micro>( t_clock::now() - since ).count();
+	}
+
+
+	double threadCpuUs()
+	{
+#if defined( _WIN32 )
+		return std::clock() * 1e6 / CLOCKS_PER_SEC;
+#else
+		timespec ts;
+		clock_gettime( CLOCK_THREAD_CPUTIME_ID, &ts );
+
+		return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+#endif
+	}
+
+
+	void printStats( const std::string_view name, std::vector<double> values, const std::string_view unit )
+	{
+		if ( values.empty() ) {
+			std::cout << name << ": no samples" << std::endl;
+			return;
+		}
+
+		std::sort( values.begin(), values.end() );
+
+		double sum = 0;
+
+		for ( auto v : values ) {
+			sum += v;
+		}
+
+		auto at = [&values]( double q ) { return values[static_cast<size_t>( q * ( values.size() - 1 ) )]; };
+
+		std::cout << name << " (" << unit << "): n=" << values.size() << " min=" << values.front()
+				  << " p50=" << at( 0.5 ) << " p99=" << at( 0.99 ) << " max=" << values.back()
+				  << " avg=" << sum / values.size() << std::endl;
+	}
+
+
+	/// time and allocations from reconnect() until the next connect reply
+	int reconnectBench( const std::string_view url, const std::string_view token, size_t count )
+	{
+		std::vector<double> latencies;
+		std::vector<double> allocs;
+
+		auto startTs = t_clock::now();
+		size_t startAllocs = g_allocCount;
+
+		as::CentrifugeClient client(
+			url,
+			[token] { return as::t_string( token ); },
+			[&]( as::CentrifugeClientBase & client ) {
+				latencies.push_back( elapsedUs( startTs ) );
+				allocs.push_back( static_cast<double>( g_allocCount - startAllocs ) );
+
+				if ( latencies.size() > count ) {
+					client.stop();
+					return;
+				}
+
+				startTs = t_clock::now();
+				startAllocs = g_allocCount;
+				client.reconnect();
+			},
+			[]( auto &, const std::string_view, const std::string_view ) {} );
+
+		client.run();
+
+		std::cout << "initial connect: " << latencies.front() << " us, " << allocs.front() << " allocations"
+				  << std::endl;
+
+		latencies.erase( latencies.begin() );
+		allocs.erase( allocs.begin() );
+
+		printStats( "reconnect latency", latencies, "us" );
+		printStats( "allocations per reconnect", allocs, "count" );
+
+		if ( auto ws = client.Connection() ) {
+			std::cout << "tls handshakes: " << ws->TlsHandshakeCount() << " resumed: " << ws->TlsResumedCount()
+					  << " rate: " << ws->TlsResumptionRate() << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	/// reconnectBench against the in-process server, ws and wss; the initial connect also builds what the
+	/// reconnects reuse (io context, ssl context, watchdog), as every connect did before they were kept
+	int localReconnectBench( size_t count )
+	{
+		bench::t_serverOptions options;
+		options.count = 0;
+
+		for ( bool isTls : { false, true } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, options, isTls );
+
+			as::t_string url = as::t_string( isTls ? "wss" : "ws" ) + "://127.0.0.1:"
+				+ std::to_string( server.Endpoint().port() ) + "/connection/websocket";
+
+			std::cout << ( isTls ? "wss" : "ws" ) << std::endl;
+			reconnectBench( url, "", count );
+		}
+
+		return 0;
+	}
+
+
+	struct t_throughput {
+		size_t messages = 0;
+		size_t bytes = 0;
+		double wallUs = 0;
+		double cpuUs = 0;
+		std::vector<double> latenciesUs;
+		bool isKtls = false;
+		as::t_spinStats spin;
+	};
+
+
+	void printThroughput( const std::string_view name, const t_throughput & r )
+	{
+		auto mb = r.bytes / ( 1024.0 * 1024.0 );
+
+		std::cout << name << ": " << r.messages << " msgs, " << r.messages * 1e6 / r.wallUs << " msgs/s, "
+				  << mb * 1e6 / r.wallUs << " MB/s, cpu " << r.cpuUs / mb << " us/MB, "
+				  << r.cpuUs * 1e3 / r.messages << " ns/msg" << std::endl;
+
+		printStats( std::string( name ) + " latency", r.latenciesUs, "us" );
+	}
+
+
+	/// receives count publications from url, cpu time is the one of the client io thread
+	t_throughput receive( const as::t_string & url, size_t count, const as::t_wsOptions & options = {} )
+	{
+		t_throughput r;
+		r.latenciesUs.reserve( count );
+
+		t_clock::time_point startTs;
+		double startCpuUs = 0;
+
+		as::CentrifugeClient client(
+			url,
+			[] { return as::t_string(); },
+			[]( as::CentrifugeClientBase & client ) { client.subscribe( "bench" ); },
+			[&]( as::CentrifugeClientBase & client, const std::string_view, const std::string_view data ) {
+				if ( 0 == r.messages++ ) {
+					startTs = t_clock::now();
+					startCpuUs = threadCpuUs();
+				}
+
+				r.bytes += data.size();
+
+				if ( data.size() >= sizeof( int64_t ) ) {
+					int64_t ts;
+					std::memcpy( &ts, data.data(), sizeof ts );
+					r.latenciesUs.push_back( ( bench::nowNs() - ts ) / 1e3 );
+				}
+
+				if ( r.messages == count ) {
+					r.wallUs = elapsedUs( startTs );
+					r.cpuUs = threadCpuUs() - startCpuUs;
+					client.stop();
+				}
+			} );
+
+		client.WsOptions( options );
+		client.run();
+
+		if ( auto ws = client.Connection() ) {
+			r.isKtls = ws->IsKtls();
+			r.spin = ws->SpinStats();
+		}
+
+		return r;
+	}
+
+
+	/// plain ws against wss over loopback TCP, and ws over a unix domain socket
+	int transportBench( size_t count, size_t size )
+	{
+		bench::t_serverOptions options;
+		options.count = count;
+		options.size = size;
+
+		for ( bool isTls : { false, true } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, options, isTls );
+
+			as::t_string url = as::t_string( isTls ? "wss" : "ws" ) + "://127.0.0.1:"
+				+ std::to_string( server.Endpoint().port() ) + "/connection/websocket";
+
+			printThroughput( isTls ? "wss" : "ws", receive( url, count ) );
+		}
+
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+		auto path = ( std::filesystem::temp_directory_path() / "centrifugepp-bench.sock" ).string();
+		std::filesystem::remove( path );
+
+		{
+			bench::BenchServer<boost::asio::local::stream_protocol> server( path, options, false );
+			printThroughput( "ws+unix", receive( "ws+unix://" + path + ":/connection/websocket", count ) );
+		}
+
+		std::filesystem::remove( path );
+#endif
+
+		return 0;
+	}
+
+
+	/// permessage-deflate settings against the same payload, wire bytes are counted by the server
+	int deflateBench( size_t count, size_t size )
+	{
+		struct t_setting {
+			const char * name;
+			bool isEnabled;
+			int windowBits;
+			bool isNoContextTakeover;
+			int memLevel;
+		};
+
+		static const t_setting settings[] = {
+			{ "off", false, 15, false, 8 },
+			{ "window 15, takeover, mem 8", true, 15, false, 8 },
+			{ "window 15, no takeover, mem 8", true, 15, true, 8 },
+			{ "window 12, takeover, mem 4", true, 12, false, 4 },
+			{ "window 9, takeover, mem 1", true, 9, false, 1 },
+			{ "window 9, no takeover, mem 1", true, 9, true, 1 },
+		};
+
+		for ( const auto & setting : settings ) {
+			boost::beast::websocket::permessage_deflate deflate;
+			deflate.client_enable = setting.isEnabled;
+			deflate.server_enable = setting.isEnabled;
+			deflate.client_max_window_bits = setting.windowBits;
+			deflate.server_max_window_bits = setting.windowBits;
+			deflate.client_no_context_takeover = setting.isNoContextTakeover;
+			deflate.server_no_context_takeover = setting.isNoContextTakeover;
+			deflate.memLevel = setting.memLevel;
+
+			bench::t_serverOptions serverOptions;
+			serverOptions.count = count;
+			serverOptions.size = size;
+			serverOptions.deflate = deflate;
+
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			as::t_wsOptions options;
+			options.deflate = deflate;
+
+			auto r = receive( "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				count,
+				options );
+
+			std::cout << setting.name << ": " << r.messages * 1e6 / r.wallUs << " msgs/s, cpu "
+					  << r.cpuUs * 1e3 / r.messages << " ns/msg, wire " << double( server.BytesSent() ) / r.messages
+					  << " B/msg for " << size << " B payloads" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+
+	/// paced single-publication frames, client socket options against delivery latency
+	int latencyBench( size_t count, as::t_timespan intervalUs )
+	{
+		struct t_setting {
+			const char * name;
+			as::t_socketOptions socket;
+		};
+
+		t_setting settings[4];
+
+		settings[0].name = "os defaults";
+		settings[0].socket.isNoDelay = false;
+
+		settings[1].name = "nodelay";
+
+		settings[2].name = "nodelay, quickack";
+		settings[2].socket.isQuickAck = true;
+
+		settings[3].name = "nodelay, quickack, busy poll 50 us";
+		settings[3].socket.isQuickAck = true;
+		settings[3].socket.busyPollUs = 50;
+
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.batch = 1;
+		serverOptions.intervalUs = intervalUs;
+
+		for ( const auto & setting : settings ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			as::t_wsOptions options;
+			options.socket = setting.socket;
+
+			auto r = receive( "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				count,
+				options );
+
+			printStats( setting.name, r.latenciesUs, "us" );
+		}
+
+		return 0;
+	}
+
+
+
+	/// paced single-publication frames, blocking io thread against one spinning on poll()
+	int spinBench( size_t count, as::t_timespan intervalUs )
+	{
+		struct t_setting {
+			const char * name;
+			as::t_runOptions run;
+		};
+
+		t_setting settings[4];
+
+		settings[0].name = "blocking";
+
+		settings[1].name = "spin";
+		settings[1].run.mode = as::t_runMode::Spin;
+
+		settings[2].name = "spin, 16 pauses";
+		settings[2].run.mode = as::t_runMode::Spin;
+		settings[2].run.pauseCount = 16;
+
+		settings[3].name = "spin, blocks after 50 us idle";
+		settings[3].run.mode = as::t_runMode::Spin;
+		settings[3].run.idleUs = 50;
+
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.batch = 1;
+		serverOptions.intervalUs = intervalUs;
+
+		for ( const auto & setting : settings ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			as::t_wsOptions options;
+			options.run = setting.run;
+
+			auto r = receive( "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				count,
+				options );
+
+			printStats( setting.name, r.latenciesUs, "us" );
+
+			if ( r.spin.polls > 0 ) {
+				auto totalNs = double( r.spin.workNs + r.spin.spinNs + r.spin.sleepNs );
+
+				std::cout << "  polls " << r.spin.polls << ", idle " << r.spin.idlePolls << ", work "
+						  << 100 * r.spin.workNs / totalNs << "%, spin " << 100 * r.spin.spinNs / totalNs
+						  << "%, blocked " << 100 * r.spin.sleepNs / totalNs << "%" << std::endl;
+			}
+		}
+
+		return 0;
+	}
+
+
+
+	/// paced publications handled on the application thread: handed over by a consumer ring from the client's own
+	/// io thread, or with the client driven by the application loop itself
+	int driveBench( size_t count, as::t_timespan intervalUs )
+	{
+		enum class t_mode { Handoff, RunFor, Epoll };
+
+		struct t_setting {
+			const char * name;
+			t_mode mode;
+		};
+
+		std::vector<t_setting> settings{ { "run() + consumer thread", t_mode::Handoff },
+			{ "open() + runFor() loop", t_mode::RunFor } };
+
+#if defined( __linux__ )
+		settings.push_back( { "open() + epoll on the socket + poll()", t_mode::Epoll } );
+#endif
+
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.batch = 1;
+		serverOptions.intervalUs = intervalUs;
+
+		for ( const auto & setting : settings ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			std::vector<double> latenciesUs;
+			latenciesUs.reserve( count );
+
+			as::CentrifugeClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[]( as::CentrifugeClientBase & client ) { client.subscribe( "bench" ); },
+				[&]( as::CentrifugeClientBase & client, const std::string_view, const std::string_view data ) {
+					int64_t ts;
+					std::memcpy( &ts, data.data(), sizeof ts );
+					latenciesUs.push_back( ( bench::nowNs() - ts ) / 1e3 );
+
+					if ( latenciesUs.size() == count ) {
+						client.stop();
+					}
+				} );
+
+			if ( t_mode::Handoff == setting.mode ) {
+				as::t_deliveryOptions delivery;
+				delivery.consumers = 1;
+				client.Delivery( delivery );
+				client.run();
+			}
+			else {
+				client.open();
+			}
+
+			if ( t_mode::RunFor == setting.mode ) {
+				while ( !client.IsStopped() ) {
+					client.runFor( 1000 );
+				}
+			}
+
+#if defined( __linux__ )
+			if ( t_mode::Epoll == setting.mode ) {
+				auto epoll = epoll_create1( 0 );
+				int64_t watched = -1;
+
+				while ( !client.IsStopped() ) {
+					auto fd = client.Connection() != nullptr ? client.Connection()->NativeHandle() : -1;
+
+					if ( fd != watched ) {
+						epoll_event event{};
+						event.events = EPOLLIN;
+
+						if ( watched >= 0 ) {
+							epoll_ctl( epoll, EPOLL_CTL_DEL, static_cast<int>( watched ), nullptr );
+						}
+
+						if ( fd >= 0 ) {
+							epoll_ctl( epoll, EPOLL_CTL_ADD, static_cast<int>( fd ), &event );
+						}
+
+						watched = fd;
+					}
+
+					epoll_event event;
+					epoll_wait( epoll, &event, 1, 1 );
+					client.poll();
+				}
+
+				close( epoll );
+			}
+#endif
+
+			printStats( setting.name, latenciesUs, "us" );
+		}
+
+		return 0;
+	}
+
+
+
+	/// connections pooled against one server, each client on its own io thread
+	///
+	/// syscalls per message come from the outside, e.g. perf stat -e raw_syscalls:sys_enter or strace -c -f
+	int poolBench( size_t connections, size_t count, size_t size )
+	{
+#if defined( BOOST_ASIO_HAS_IO_URING ) && defined( BOOST_ASIO_DISABLE_EPOLL )
+		std::cout << "reactor: io_uring" << std::endl;
+#else
+		std::cout << "reactor: epoll/default" << std::endl;
+#endif
+
+		bench::t_serverOptions options;
+		options.count = count;
+		options.size = size;
+
+		bench::BenchServer<boost::asio::ip::tcp> server(
+			{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+		as::t_string url = "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket";
+
+		std::vector<t_throughput> results( connections );
+		std::vector<std::thread> threads;
+		threads.reserve( connections );
+
+		auto startTs = t_clock::now();
+
+		for ( size_t i = 0; i < connections; ++i ) {
+			threads.emplace_back( [&, i] { results[i] = receive( url, count ); } );
+		}
+
+		for ( auto & t : threads ) {
+			t.join();
+		}
+
+		t_throughput total;
+		total.wallUs = elapsedUs( startTs );
+
+		for ( auto & r : results ) {
+			total.messages += r.messages;
+			total.bytes += r.bytes;
+			total.cpuUs += r.cpuUs;
+			total.latenciesUs.insert( total.latenciesUs.end(), r.latenciesUs.begin(), r.latenciesUs.end() );
+		}
+
+		printThroughput( std::to_string( connections ) + " connections", total );
+
+		return 0;
+	}
+
+
+
+	/// the same connections on a few pinned cores of an Engine instead of a thread each
+	int engineBench( size_t connections, size_t cores, size_t count, size_t size )
+	{
+		using t_client = as::CentrifugeClient<std::function<as::t_string()>,
+			std::function<void( as::CentrifugeClientBase & )>,
+			std::function<void( as::CentrifugeClientBase &, const std::string_view, const std::string_view )>>;
+
+		bench::t_serverOptions options;
+		options.count = count;
+		options.size = size;
+
+		bench::BenchServer<boost::asio::ip::tcp> server(
+			{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+		as::t_string url = "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket";
+
+		as::t_engineOptions engineOptions;
+
+		for ( size_t i = 0; i < cores; ++i ) {
+			engineOptions.cpus.push_back( static_cast<int>( i % std::max( std::thread::hardware_concurrency(), 1u ) ) );
+		}
+
+		as::Engine engine( engineOptions );
+
+		std::vector<t_throughput> results( connections );
+		std::vector<std::unique_ptr<t_client>> clients;
+
+		for ( auto & r : results ) {
+			r.latenciesUs.reserve( count );
+
+			clients.push_back( std::make_unique<t_client>(
+				url,
+				[] { return as::t_string(); },
+				[]( as::CentrifugeClientBase & client ) { client.subscribe( "bench" ); },
+				[&r, count]( as::CentrifugeClientBase & client, const std::string_view, const std::string_view data ) {
+					r.bytes += data.size();
+
+					int64_t ts;
+					std::memcpy( &ts, data.data(), sizeof ts );
+					r.latenciesUs.push_back( ( bench::nowNs() - ts ) / 1e3 );
+
+					if ( ++r.messages == count ) {
+						client.stop();
+					}
+				} ) );
+		}
+
+		auto startTs = t_clock::now();
+
+		for ( auto & client : clients ) {
+			engine.add( *client );
+		}
+
+		engine.wait();
+
+		t_throughput total;
+		total.wallUs = elapsedUs( startTs );
+
+		for ( auto & r : results ) {
+			total.messages += r.messages;
+			total.bytes += r.bytes;
+			total.latenciesUs.insert( total.latenciesUs.end(), r.latenciesUs.begin(), r.latenciesUs.end() );
+		}
+
+		std::cout << connections << " connections on " << engine.CoreCount()
+				  << " cores: " << total.messages * 1e6 / total.wallUs << " msgs/s" << std::endl;
+		printStats( "latency", total.latenciesUs, "us" );
+
+		return 0;
+	}
+
+
+
+	/// channels sharded over 1 to 16 connections, and the share of channels a resize moves
+	int shardsBench( size_t count, size_t channels )
+	{
+		for ( size_t shards = 1; shards <= 16; shards *= 2 ) {
+			bench::t_serverOptions options;
+			options.count = count / shards;
+
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+			std::atomic_size_t received{ 0 };
+			std::atomic_int64_t firstNs{ 0 };
+			auto total = options.count * shards;
+
+			as::t_shardOptions shardOptions;
+			shardOptions.shards = shards;
+
+			as::ShardedClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[&]( as::CentrifugeClientBase &, as::t_channelId, const as::SharedBuffer & ) {
+					if ( 0 == received.fetch_add( 1, std::memory_order_relaxed ) ) {
+						firstNs = bench::nowNs();
+					}
+				},
+				shardOptions );
+
+			for ( size_t i = 0; i < channels; ++i ) {
+				client.subscribe( "bench:" + std::to_string( i ) );
+			}
+
+			client.start();
+
+			while ( received < total ) {
+				std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+			}
+
+			auto wallUs = ( bench::nowNs() - firstNs ) / 1e3;
+			client.stop();
+
+			std::cout << shards << " shards: " << total * 1e6 / wallUs << " msgs/s" << std::endl;
+		}
+
+		as::ShardedClient client( "ws://127.0.0.1/", [] { return as::t_string(); }, []( auto &, auto, auto ) {} );
+
+		for ( size_t i = 0; i < channels; ++i ) {
+			client.subscribe( "bench:" + std::to_string( i ) );
+		}
+
+		for ( size_t shards = 2; shards <= 16; ++shards ) {
+			auto moved = client.resize( shards );
+
+			std::cout << "resize to " << shards << ": " << 100.0 * moved / channels << "% of the channels moved"
+					  << std::endl;
+		}
+
+		return 0;
+	}
+
+
+
+	/// local subscribers of one channel sharing a connection through FanOut, against a client each
+	int fanOutBench( size_t subscribers, size_t count, size_t size )
+	{
+		bench::t_serverOptions options;
+		options.count = count;
+		options.size = size;
+
+		{
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+			size_t delivered = 0;
+			t_clock::time_point startTs;
+
+			as::FanOut * fanOut = nullptr;
+
+			as::CentrifugeClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[&]( as::CentrifugeClientBase & ) { fanOut->resubscribe(); },
+				[]( as::CentrifugeClientBase &, const std::string_view, const std::string_view ) {} );
+
+			as::FanOut hub( client );
+			fanOut = &hub;
+
+			std::vector<as::SharedBuffer> last( subscribers );
+
+			for ( size_t i = 0; i < subscribers; ++i ) {
+				hub.subscribe( "bench",
+					[&, i]( as::CentrifugeClientBase & client, as::t_channelId, const as::SharedBuffer & data ) {
+						if ( 0 == delivered++ ) {
+							startTs = t_clock::now();
+						}
+
+						last[i] = data;
+
+						if ( delivered == count * subscribers ) {
+							client.stop();
+						}
+					} );
+			}
+
+			client.run();
+
+			std::cout << subscribers << " subscribers on one connection: "
+					  << delivered * 1e6 / elapsedUs( startTs ) << " deliveries/s, wire " << server.BytesSent() / 1024
+					  << " KiB, upstream channels " << hub.UpstreamCount() << std::endl;
+		}
+
+		bench::BenchServer<boost::asio::ip::tcp> server(
+			{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+		as::t_string url = "ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket";
+
+		std::vector<t_throughput> results( subscribers );
+		std::vector<std::thread> threads;
+
+		for ( size_t i = 0; i < subscribers; ++i ) {
+			threads.emplace_back( [&, i] { results[i] = receive( url, count ); } );
+		}
+
+		for ( auto & t : threads ) {
+			t.join();
+		}
+
+		size_t delivered = 0;
+		double wallUs = 0;
+
+		for ( auto & r : results ) {
+			delivered += r.messages;
+			wallUs = std::max( wallUs, r.wallUs );
+		}
+
+		std::cout << subscribers << " subscribers, a connection each: " << delivered * 1e6 / wallUs
+				  << " deliveries/s, wire " << server.BytesSent() / 1024 << " KiB" << std::endl;
+
+		return 0;
+	}
+
+
+
+	/// local clients behind a relay sharing one upstream connection, against a connection each
+	int relayBench( size_t clients, size_t count, size_t size )
+	{
+		bench::t_serverOptions options;
+		options.count = count;
+		options.size = size;
+		// the local clients are all subscribed before publishing starts
+		options.startDelayMs = 1000;
+
+		for ( bool isRelay : { true, false } ) {
+			bench::BenchServer<boost::asio::ip::tcp> upstream(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, options, false );
+
+			as::t_string url =
+				"ws://127.0.0.1:" + std::to_string( upstream.Endpoint().port() ) + "/connection/websocket";
+
+			boost::asio::io_context relayIo( 1 );
+			std::optional<relay::RelayHub> hub;
+
+			as::CentrifugeClient relayClient(
+				url,
+				[] { return as::t_string(); },
+				[&hub]( as::CentrifugeClientBase & ) { hub->resubscribe(); },
+				[]( as::CentrifugeClientBase &, const std::string_view, const std::string_view ) {} );
+
+			hub.emplace( relayClient );
+
+			relay::RelayServer<boost::asio::ip::tcp> relayServer(
+				relayIo, { boost::asio::ip::address_v4::loopback(), 0 }, *hub );
+
+			std::thread relayThread;
+
+			if ( isRelay ) {
+				url = "ws://127.0.0.1:" + std::to_string( relayServer.Endpoint().port() ) + "/";
+				relayClient.start( relayIo );
+				relayThread = std::thread( [&relayIo] { relayIo.run(); } );
+			}
+
+			std::vector<t_throughput> results( clients );
+			std::vector<std::thread> threads;
+
+			for ( size_t i = 0; i < clients; ++i ) {
+				threads.emplace_back( [&, i] { results[i] = receive( url, count ); } );
+			}
+
+			for ( auto & t : threads ) {
+				t.join();
+			}
+
+			size_t delivered = 0;
+			double wallUs = 0;
+
+			for ( auto & r : results ) {
+				delivered += r.messages;
+				wallUs = std::max( wallUs, r.wallUs );
+			}
+
+			std::cout << clients << ( isRelay ? " clients behind a relay: " : " clients, a connection each: " )
+					  << delivered * 1e6 / wallUs << " deliveries/s, upstream wire " << upstream.BytesSent() / 1024
+					  << " KiB";
+
+			if ( isRelay ) {
+				boost::asio::post( relayIo, [&] {
+					relayClient.stop();
+					relayServer.close();
+				} );
+
+				relayThread.join();
+
+				std::cout << ", " << hub->PublicationCount() << " publications serialized";
+			}
+
+			std::cout << std::endl;
+		}
+
+		return 0;
+	}
+
+
+
+	/// wss with userspace TLS against kernel TLS, client cpu per GB received
+	int ktlsBench( size_t count, size_t size )
+	{
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.size = size;
+		serverOptions.isTls12 = true;
+
+		for ( bool isKtls : { false, true } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, true );
+
+			as::t_wsOptions options;
+			options.isKtls = isKtls;
+
+			auto r = receive( "wss://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				count,
+				options );
+
+			auto gb = r.bytes / ( 1024.0 * 1024.0 * 1024.0 );
+
+			std::cout << ( isKtls ? "ktls requested" : "userspace tls" )
+					  << " (in use: " << ( r.isKtls ? "ktls" : "userspace" ) << "): " << r.messages * 1e6 / r.wallUs
+					  << " msgs/s, cpu " << r.cpuUs / 1e6 / gb << " s/GB" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+
+	/// io thread to consumer thread through SpscRing, back to back and paced every intervalNs
+	int handoffBench( size_t count, int64_t intervalNs )
+	{
+		static const std::pair<const char *, as::t_waitStrategy> strategies[] = {
+			{ "spin", as::t_waitStrategy::Spin },
+			{ "yield", as::t_waitStrategy::Yield },
+			{ "futex", as::t_waitStrategy::Futex },
+		};
+
+		for ( const auto & [name, strategy] : strategies ) {
+			for ( auto interval : { int64_t( 0 ), intervalNs } ) {
+				as::SpscRing<int64_t> ring( 4096, strategy );
+				std::vector<double> latencies;
+				latencies.reserve( count );
+
+				std::thread consumer( [&] {
+					int64_t ts;
+
+					while ( ring.pop( ts ) ) {
+						latencies.push_back( ( bench::nowNs() - ts ) / 1e3 );
+					}
+				} );
+
+				auto startTs = t_clock::now();
+
+				for ( size_t i = 0; i < count; ++i ) {
+					auto ts = bench::nowNs();
+
+					if ( interval > 0 ) {
+						while ( bench::nowNs() - ts < interval ) {
+						}
+
+						ts = bench::nowNs();
+					}
+
+					ring.push( std::move( ts ) );
+				}
+
+				ring.close();
+				consumer.join();
+
+				auto wallUs = elapsedUs( startTs );
+
+				auto title = std::string( name )
+					+ ( interval > 0 ? ", paced " + std::to_string( interval ) + " ns" : ", burst" );
+				std::cout << title << ": " << count * 1e6 / wallUs << " items/s" << std::endl;
+				printStats( title + " handoff", latencies, "us" );
+			}
+		}
+
+		return 0;
+	}
+
+
+	/// feeds prepared frames straight into wsReadHandler, no socket involved
+	class DecodeFeeder : public as::CentrifugeClientBase {
+	protected:
+		std::atomic_size_t m_delivered{ 0 };
+		std::atomic_size_t m_bytes{ 0 };
+
+	protected:
+		as::t_string Token() override
+		{
+			return {};
+		}
+
+
+		void OnConnect( CentrifugeClientBase & ) override
+		{
+		}
+
+
+		void OnPub(
+			CentrifugeClientBase &, as::t_channelId, const std::string_view, const as::SharedBuffer & data ) override
+		{
+			m_bytes.fetch_add( data.Size(), std::memory_order_relaxed );
+			m_delivered.fetch_add( 1, std::memory_order_relaxed );
+		}
+
+	public:
+		/// never connects
+		void start( boost::asio::io_context &, std::function<void()> && ) override
+		{
+		}
+
+
+		/// setup: routes and batch handler, before the consumers start
+		DecodeFeeder( const as::t_deliveryOptions & options,
+			const std::function<void( CentrifugeClientBase & )> & setup = {} )
+		{
+			Delivery( options );
+
+			if ( setup ) {
+				setup( *this );
+			}
+
+			startConsumers();
+		}
+
+
+		~DecodeFeeder()
+		{
+			stopConsumers();
+			closeSubscriptions();
+		}
+
+
+		void feed( as::WsClientBase & ws, const std::string & frame )
+		{
+			wsReadHandler( ws, frame.data(), frame.size() );
+		}
+
+
+		size_t Delivered() const
+		{
+			return m_delivered;
+		}
+
+
+		size_t Bytes() const
+		{
+			return m_bytes;
+		}
+	};
+
+
+	/// cost of queued delivery: the io thread finds and copies every payload either way, the handler runs inline
+	/// against on 1, 2, 4 and 8 consumers
+	int consumersBench( size_t count, size_t size )
+	{
+		static const size_t batch = 16;
+		static const size_t channels = 64;
+
+		std::string payload( size, 'x' );
+		std::vector<std::string> frames( channels );
+
+		for ( size_t c = 0; c < channels; ++c ) {
+			centrifugal::centrifuge::protocol::Reply reply;
+			auto pub = reply.mutable_push()->mutable_pub();
+			pub->set_channel( "bench" + std::to_string( c ) );
+			pub->set_data( payload );
+
+			std::string message;
+			as::CentrifugeClientBase::serialize( message, reply );
+
+			for ( size_t i = 0; i < batch; ++i ) {
+				frames[c] += message;
+			}
+		}
+
+		as::WsClient ws(
+			as::Url( "ws://127.0.0.1/" ),
+			[]( auto &, int, const as::t_stringview ) {},
+			[]( auto & ) {},
+			[]( auto &, const char *, size_t ) { return true; } );
+
+		for ( size_t workers : { 0, 1, 2, 4, 8 } ) {
+			as::t_deliveryOptions options;
+			options.consumers = workers;
+
+			DecodeFeeder feeder( options );
+
+			auto frameCount = count / batch;
+			auto startTs = t_clock::now();
+			auto startCpuUs = threadCpuUs();
+
+			for ( size_t i = 0; i < frameCount; ++i ) {
+				feeder.feed( ws, frames[i % channels] );
+			}
+
+			auto ioCpuUs = threadCpuUs() - startCpuUs;
+
+			while ( feeder.Delivered() < frameCount * batch ) {
+				std::this_thread::yield();
+			}
+
+			auto wallUs = elapsedUs( startTs );
+
+			std::cout << ( 0 == workers ? "io thread" : std::to_string( workers ) + " consumers" ) << ": "
+					  << frameCount * batch * 1e6 / wallUs << " msgs/s, "
+					  << feeder.Bytes() / ( 1024.0 * 1024.0 ) * 1e6 / wallUs << " MB/s, io thread cpu "
+					  << ioCpuUs * 1e3 / ( frameCount * batch ) << " ns/msg" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	/// a sink with a fixed cost per call (a lock and 2 us, say a DB round trip) and 20 ns per publication, called per
+	/// publication against per batch
+	int batchBench( size_t count, size_t size )
+	{
+		static const size_t batch = 16;
+
+		std::string frame;
+		centrifugal::centrifuge::protocol::Reply reply;
+		auto pub = reply.mutable_push()->mutable_pub();
+		pub->set_channel( "bench" );
+		pub->set_data( std::string( size, 'x' ) );
+
+		std::string message;
+		as::CentrifugeClientBase::serialize( message, reply );
+
+		for ( size_t i = 0; i < batch; ++i ) {
+			frame += message;
+		}
+
+		as::WsClient ws(
+			as::Url( "ws://127.0.0.1/" ),
+			[]( auto &, int, const as::t_stringview ) {},
+			[]( auto & ) {},
+			[]( auto &, const char *, size_t ) { return true; } );
+
+		std::mutex sync;
+		std::atomic_size_t sunk{ 0 };
+		std::atomic_size_t calls{ 0 };
+
+		auto sink = [&]( size_t n ) {
+			std::lock_guard<std::mutex> lock( sync );
+			auto ts = bench::nowNs();
+
+			while ( bench::nowNs() - ts < 2000 + 20 * static_cast<int64_t>( n ) ) {
+			}
+
+			sunk += n;
+			++calls;
+		};
+
+		for ( size_t workers : { 0, 1 } ) {
+			for ( bool isBatched : { false, true } ) {
+				as::t_deliveryOptions options;
+				options.consumers = workers;
+
+				DecodeFeeder feeder( options, [&]( as::CentrifugeClientBase & client ) {
+					if ( isBatched ) {
+						client.batch( [&]( as::CentrifugeClientBase &, std::span<const as::t_pubView> pubs ) {
+							sink( pubs.size() );
+						} );
+					}
+					else {
+						client.route( "*", [&]( as::CentrifugeClientBase &, as::t_channelId, const std::string_view ) {
+							sink( 1 );
+						} );
+					}
+				} );
+
+				sunk = 0;
+				calls = 0;
+
+				auto frameCount = count / batch;
+				auto startTs = t_clock::now();
+
+				for ( size_t i = 0; i < frameCount; ++i ) {
+					feeder.feed( ws, frame );
+				}
+
+				while ( sunk < frameCount * batch ) {
+					std::this_thread::yield();
+				}
+
+				auto wallUs = elapsedUs( startTs );
+
+				std::cout << ( 0 == workers ? "io thread" : "1 consumer" )
+						  << ( isBatched ? ", batch handler: " : ", per publication: " )
+						  << frameCount * batch * 1e6 / wallUs << " msgs/s, " << double( sunk ) / calls
+						  << " publications/call" << std::endl;
+			}
+		}
+
+		return 0;
+	}
+
+
+	/// a handler that keeps the last 1024 payloads for later, by copying them against by holding their buffers
+	int buffersBench( size_t count, size_t size )
+	{
+		static const size_t batch = 16;
+		static const size_t kept = 1024;
+
+		std::string frame;
+		centrifugal::centrifuge::protocol::Reply reply;
+		auto pub = reply.mutable_push()->mutable_pub();
+		// longer than the small string buffer, as real channel names are
+		pub->set_channel( "public:obtained-skins" );
+		pub->set_data( std::string( size, 'x' ) );
+
+		std::string message;
+		as::CentrifugeClientBase::serialize( message, reply );
+
+		for ( size_t i = 0; i < batch; ++i ) {
+			frame += message;
+		}
+
+		as::WsClient ws(
+			as::Url( "ws://127.0.0.1/" ),
+			[]( auto &, int, const as::t_stringview ) {},
+			[]( auto & ) {},
+			[]( auto &, const char *, size_t ) { return true; } );
+
+		for ( bool isShared : { false, true } ) {
+			std::vector<std::string> copies( kept );
+			std::vector<as::SharedBuffer> buffers( kept );
+			size_t n = 0;
+
+			DecodeFeeder feeder( {}, [&]( as::CentrifugeClientBase & client ) {
+				if ( isShared ) {
+					client.route(
+						"*", [&]( as::CentrifugeClientBase &, as::t_channelId, const as::SharedBuffer & data ) {
+							buffers[n++ % kept] = data;
+						} );
+				}
+				else {
+					client.route( "*", [&]( as::CentrifugeClientBase &, as::t_channelId, const std::string_view data ) {
+						copies[n++ % kept] = std::string( data );
+					} );
+				}
+			} );
+
+			auto frameCount = count / batch;
+
+			// warms the pool, the kept slots and the caches up, then the best of three passes
+			for ( size_t i = 0; i < frameCount / 4; ++i ) {
+				feeder.feed( ws, frame );
+			}
+
+			double bestNs = 0;
+			double allocsPerMsg = 0;
+
+			for ( size_t pass = 0; pass < 3; ++pass ) {
+				auto startN = n;
+				auto startAllocs = g_allocCount.load();
+				auto startTs = t_clock::now();
+
+				for ( size_t i = 0; i < frameCount; ++i ) {
+					feeder.feed( ws, frame );
+				}
+
+				auto ns = elapsedUs( startTs ) * 1e3 / ( n - startN );
+
+				if ( 0 == pass || ns < bestNs ) {
+					bestNs = ns;
+					allocsPerMsg = double( g_allocCount - startAllocs ) / ( n - startN );
+				}
+			}
+
+			std::cout << ( isShared ? "shared buffer: " : "string copy: " ) << bestNs << " ns/msg, " << allocsPerMsg
+					  << " allocations/msg" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	as::Task drain( as::Subscription & sub, size_t & n, size_t & bytes )
+	{
+		while ( auto pub = co_await sub.next() ) {
+			bytes += pub->data.Size();
+			++n;
+		}
+	}
+
+
+	/// per-publication route handler against a coroutine awaiting a subscription, decoding on the io thread
+	int streamBench( size_t count, size_t size )
+	{
+		static const size_t batch = 16;
+
+		std::string frame;
+		centrifugal::centrifuge::protocol::Reply reply;
+		auto pub = reply.mutable_push()->mutable_pub();
+		// longer than the small string buffer, as real channel names are
+		pub->set_channel( "public:obtained-skins" );
+		pub->set_data( std::string( size, 'x' ) );
+
+		std::string message;
+		as::CentrifugeClientBase::serialize( message, reply );
+
+		for ( size_t i = 0; i < batch; ++i ) {
+			frame += message;
+		}
+
+		as::WsClient ws(
+			as::Url( "ws://127.0.0.1/" ),
+			[]( auto &, int, const as::t_stringview ) {},
+			[]( auto & ) {},
+			[]( auto &, const char *, size_t ) { return true; } );
+
+		for ( bool isCoroutine : { false, true } ) {
+			size_t n = 0;
+			size_t bytes = 0;
+			as::Subscription * sub = nullptr;
+
+			DecodeFeeder feeder( {}, [&]( as::CentrifugeClientBase & client ) {
+				if ( isCoroutine ) {
+					sub = &client.stream( "*" );
+				}
+				else {
+					client.route(
+						"*", [&]( as::CentrifugeClientBase &, as::t_channelId, const as::SharedBuffer & data ) {
+							bytes += data.Size();
+							++n;
+						} );
+				}
+			} );
+
+			if ( sub != nullptr ) {
+				drain( *sub, n, bytes );
+			}
+
+			auto frameCount = count / batch;
+			auto startAllocs = g_allocCount.load();
+			auto startTs = t_clock::now();
+
+			for ( size_t i = 0; i < frameCount; ++i ) {
+				feeder.feed( ws, frame );
+			}
+
+			auto wallUs = elapsedUs( startTs );
+			auto allocs = g_allocCount - startAllocs;
+
+			std::cout << ( isCoroutine ? "co_await next(): " : "route handler: " ) << wallUs * 1e3 / n
+					  << " ns/msg, " << double( allocs ) / n << " allocations/msg";
+
+			if ( sub != nullptr ) {
+				std::cout << ", dropped " << sub->DroppedCount();
+			}
+
+			std::cout << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	/// a consumer slower than the feed, without and with a delivery budget
+	int backpressureBench( size_t count, size_t size, size_t budgetBytes )
+	{
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.size = size;
+
+		for ( size_t budget : { size_t( 0 ), budgetBytes } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			std::atomic_size_t delivered{ 0 };
+			t_clock::time_point startTs;
+
+			as::CentrifugeClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[]( as::CentrifugeClientBase & client ) { client.subscribe( "bench" ); },
+				[&]( as::CentrifugeClientBase & client, const std::string_view, const std::string_view ) {
+					if ( 0 == delivered ) {
+						startTs = t_clock::now();
+					}
+
+					// 2 us of work per publication
+					auto ts = bench::nowNs();
+
+					while ( bench::nowNs() - ts < 2000 ) {
+					}
+
+					if ( ++delivered == count ) {
+						client.stop();
+					}
+				} );
+
+			as::t_deliveryOptions options;
+			options.consumers = 1;
+			options.capacity = 1 << 16;
+			options.budgetBytes = budget;
+			client.Delivery( options );
+
+			client.run();
+
+			auto wallUs = elapsedUs( startTs );
+
+			std::cout << ( 0 == budget ? "no budget" : "budget " + std::to_string( budget ) + " B" ) << ": "
+					  << delivered * 1e6 / wallUs << " msgs/s, peak queued " << client.PeakQueuedBytes() << " B, "
+					  << client.Connection()->ReadPauseCount() << " read pauses" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	/// a slow consumer on price-like channels, queued against conflated delivery
+	int conflateBench( size_t count, size_t channels )
+	{
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.size = 64;
+
+		for ( bool isConflated : { false, true } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			std::atomic_size_t delivered{ 0 };
+
+			as::CentrifugeClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[channels]( as::CentrifugeClientBase & client ) {
+					for ( size_t i = 0; i < channels; ++i ) {
+						client.subscribe( "bench" + std::to_string( i ) );
+					}
+				},
+				[&]( as::CentrifugeClientBase &, const std::string_view, const std::string_view ) {
+					// 5 us of work per publication
+					auto ts = bench::nowNs();
+
+					while ( bench::nowNs() - ts < 5000 ) {
+					}
+
+					++delivered;
+				} );
+
+			as::t_deliveryOptions options;
+			options.consumers = 1;
+			options.capacity = 1 << 20;
+			client.Delivery( options );
+
+			if ( isConflated ) {
+				for ( size_t i = 0; i < channels; ++i ) {
+					client.conflate( "bench" + std::to_string( i ) );
+				}
+			}
+
+			// the feed is over once nothing was delivered for a while
+			std::thread watcher( [&] {
+				size_t last = 0;
+
+				for ( ;; ) {
+					std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+					if ( delivered > 0 && delivered == last ) {
+						client.stop();
+						return;
+					}
+
+					last = delivered;
+				}
+			} );
+
+			client.run();
+			watcher.join();
+
+			auto stats = client.DeliveryStats();
+
+			std::cout << ( isConflated ? "conflated" : "queued" ) << ": delivered " << stats.delivered
+					  << ", conflated " << stats.conflated << ", lag avg " << stats.lagAvgUs << " us, max "
+					  << stats.lagMaxUs << " us" << std::endl;
+		}
+
+		return 0;
+	}
+
+
+	/// one critical channel among bulk ones behind a slow consumer, untagged against priority classes
+	int priorityBench( size_t count, size_t bulkChannels )
+	{
+		bench::t_serverOptions serverOptions;
+		serverOptions.count = count;
+		serverOptions.size = 64;
+
+		for ( bool isTagged : { false, true } ) {
+			bench::BenchServer<boost::asio::ip::tcp> server(
+				{ boost::asio::ip::address_v4::loopback(), 0 }, serverOptions, false );
+
+			std::atomic_size_t delivered{ 0 };
+			std::vector<double> criticalUs;
+			std::vector<double> bulkUs;
+
+			as::CentrifugeClient client(
+				"ws://127.0.0.1:" + std::to_string( server.Endpoint().port() ) + "/connection/websocket",
+				[] { return as::t_string(); },
+				[&]( as::CentrifugeClientBase & client ) {
+					client.subscribe( "critical", isTagged ? as::t_priority::High : as::t_priority::Normal );
+
+					for ( size_t i = 0; i < bulkChannels; ++i ) {
+						client.subscribe(
+							"bulk" + std::to_string( i ), isTagged ? as::t_priority::Low : as::t_priority::Normal );
+					}
+				},
+				[&]( as::CentrifugeClientBase &, const std::string_view channel, const std::string_view data ) {
+					int64_t ts;
+					std::memcpy( &ts, data.data(), sizeof ts );
+					( "critical" == channel ? criticalUs : bulkUs ).push_back( ( bench::nowNs() - ts ) / 1e3 );
+
+					// 2 us of work per publication
+					while ( bench::nowNs() - ts < 2000 ) {
+					}
+
+					++delivered;
+				} );
+
+			as::t_deliveryOptions options;
+			options.consumers = 1;
+			options.capacity = 1 << 14;
+			options.priorities[static_cast<size_t>( as::t_priority::Low )].overloadItems = 256;
+			client.Delivery( options );
+
+			std::thread watcher( [&] {
+				size_t last = 0;
+
+				for ( ;; ) {
+					std::this_thread::sleep_for( std::chrono::milliseconds( 500 ) );
+
+					if ( delivered > 0 && delivered == last ) {
+						client.stop();
+						return;
+					}
+
+					last = delivered;
+				}
+			} );
+
+			client.run();
+			watcher.join();
+
+			std::cout << ( isTagged ? "critical high, bulk low (drop)" : "all normal" ) << ": shed "
+					  << client.DeliveryStats().shed << std::endl;
+
+			printStats( "  critical latency", criticalUs, "us" );
+			printStats( "  bulk latency", bulkUs, "us" );
+		}
+
+		return 0;
+	}
+
+
+
+	/// per publication dispatch: a namespace if-chain plus per channel state in a hash map, against the router
+	/// and state indexed by channel id
+	int routeBench( size_t count, size_t channels )
+	{
+		static constexpr size_t Namespaces = 8;
+
+		std::vector<std::string> prefixes;
+		std::vector<std::string> names;
+		as::ChannelRegistry registry;
+
+		for ( size_t n = 0; n < Namespaces; ++n ) {
+			prefixes.push_back( "ns" + std::to_string( n ) + ":" );
+		}
+
+		for ( size_t i = 0; i < channels; ++i ) {
+			names.push_back( prefixes[i % Namespaces] + "channel" + std::to_string( i ) );
+			registry.intern( names.back() );
+		}
+
+		std::array<size_t, Namespaces> handled{};
+
+		{
+			std::unordered_map<std::string_view, size_t> state;
+			auto start = bench::nowNs();
+
+			for ( size_t i = 0; i < count; ++i ) {
+				std::string_view name = names[i % channels];
+
+				for ( size_t n = 0; n < Namespaces; ++n ) {
+					if ( name.starts_with( prefixes[n] ) ) {
+						++handled[n];
+						++state[name];
+						break;
+					}
+				}
+			}
+
+			std::cout << "if-chain + hash map: " << double( bench::nowNs() - start ) / count << " ns/publication"
+					  << std::endl;
+		}
+
+		{
+			as::ChannelRouter<std::function<void( as::t_channelId )>> router;
+			std::vector<size_t> state( channels );
+
+			for ( size_t n = 0; n < Namespaces; ++n ) {
+				router.add( prefixes[n] + "*", [&handled, &state, n]( as::t_channelId id ) {
+					++handled[n];
+					++state[id];
+				} );
+			}
+
+			auto start = bench::nowNs();
+
+			for ( size_t i = 0; i < count; ++i ) {
+				std::string_view name = names[i % channels];
+				auto id = registry.find( name );
+				( *router.resolve( id, name ) )( id );
+			}
+
+			std::cout << "interned id + router: " << double( bench::nowNs() - start ) / count << " ns/publication"
+					  << std::endl;
+		}
+
+		return handled[0] > 0 ? 0 : 1;
+	}
+
+} // namespace
+
+
+void * operator new( size_t size )
+{
+	++g_allocCount;
+
+	if ( auto p = std::malloc( size != 0 ? size : 1 ) ) {
+		return p;
+	}
+
+	throw std::bad_alloc();
+}
+
+
+[[gnu::noinline]] void operator delete( void * p ) noexcept
+{
+	std::free( p );
+}
+
+
+/// the sized form goes through the unsized one, every deallocation pairs with operator new
+void operator delete( void * p, size_t ) noexcept
+{
+	::operator delete( p );
+}
+
+
+int main( int argc, char * argv[] )
+{
+	const std::string_view scenario = argc > 1 ? argv[1] : "";
+
+	try {
+		if ( "reconnect" == scenario ) {
+			if ( argc > 3 ) {
+				return reconnectBench( argv[2], argv[3], argc > 4 ? std::stoul( argv[4] ) : 100 );
+			}
+
+			return localReconnectBench( argc > 2 ? std::stoul( argv[2] ) : 100 );
+		}
+
+		if ( "pool" == scenario ) {
+			return poolBench( argc > 2 ? std::stoul( argv[2] ) : 64,
+				argc > 3 ? std::stoul( argv[3] ) : 20000,
+				argc > 4 ? std::stoul( argv[4] ) : 256 );
+		}
+
+		if ( "relay" == scenario ) {
+			return relayBench( argc > 2 ? std::stoul( argv[2] ) : 16,
+				argc > 3 ? std::stoul( argv[3] ) : 100000,
+				argc > 4 ? std::stoul( argv[4] ) : 256 );
+		}
+
+		if ( "fanout" == scenario ) {
+			return fanOutBench( argc > 2 ? std::stoul( argv[2] ) : 16,
+				argc > 3 ? std::stoul( argv[3] ) : 100000,
+				argc > 4 ? std::stoul( argv[4] ) : 256 );
+		}
+
+		if ( "shards" == scenario ) {
+			return shardsBench( argc > 2 ? std::stoul( argv[2] ) : 320000, argc > 3 ? std::stoul( argv[3] ) : 4096 );
+		}
+
+		if ( "engine" == scenario ) {
+			return engineBench( argc > 2 ? std::stoul( argv[2] ) : 64,
+				argc > 3 ? std::stoul( argv[3] ) : std::max( std::thread::hardware_concurrency(), 1u ),
+				argc > 4 ? std::stoul( argv[4] ) : 20000,
+				argc > 5 ? std::stoul( argv[5] ) : 256 );
+		}
+
+		if ( "stream" == scenario ) {
+			return streamBench( argc > 2 ? std::stoul( argv[2] ) : 1000000, argc > 3 ? std::stoul( argv[3] ) : 256 );
+		}
+
+		if ( "buffers" == scenario ) {
+			return buffersBench( argc > 2 ? std::stoul( argv[2] ) : 1000000, argc > 3 ? std::stoul( argv[3] ) : 1024 );
+		}
+
+		if ( "batch" == scenario ) {
+			return batchBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 256 );
+		}
+
+		if ( "route" == scenario ) {
+			return routeBench( argc > 2 ? std::stoul( argv[2] ) : 10000000, argc > 3 ? std::stoul( argv[3] ) : 256 );
+		}
+
+		if ( "priority" == scenario ) {
+			return priorityBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 7 );
+		}
+
+		if ( "conflate" == scenario ) {
+			return conflateBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 16 );
+		}
+
+		if ( "backpressure" == scenario ) {
+			return backpressureBench( argc > 2 ? std::stoul( argv[2] ) : 200000,
+				argc > 3 ? std::stoul( argv[3] ) : 1024,
+				argc > 4 ? std::stoul( argv[4] ) : 1 << 20 );
+		}
+
+		if ( "consumers" == scenario ) {
+			return consumersBench(
+				argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 16384 );
+		}
+
+		if ( "handoff" == scenario ) {
+			return handoffBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stol( argv[3] ) : 20000 );
+		}
+
+		if ( "ktls" == scenario ) {
+			return ktlsBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 4096 );
+		}
+
+		if ( "drive" == scenario ) {
+			return driveBench( argc > 2 ? std::stoul( argv[2] ) : 20000, argc > 3 ? std::stol( argv[3] ) : 100 );
+		}
+
+		if ( "spin" == scenario ) {
+			return spinBench( argc > 2 ? std::stoul( argv[2] ) : 20000, argc > 3 ? std::stol( argv[3] ) : 100 );
+		}
+
+		if ( "latency" == scenario ) {
+			return latencyBench( argc > 2 ? std::stoul( argv[2] ) : 20000, argc > 3 ? std::stol( argv[3] ) : 100 );
+		}
+
+		if ( "deflate" == scenario ) {
+			return deflateBench( argc > 2 ? std::stoul( argv[2] ) : 200000, argc > 3 ? std::stoul( argv[3] ) : 1024 );
+		}
+
+		if ( "transport" == scenario ) {
+			return transportBench(
+				argc > 2 ? std::stoul( argv[2] ) : 1000000, argc > 3 ? std::stoul( argv[3] ) : 256 );
+		}
+	}
+	catch ( const std::exception & x ) {
+		std::cerr << x.what() << std::endl;
+		return 1;
+	}
+
+	std::clog << "usage: " << argv[0] << " <scenario> ..." << std::endl
+			  << "  reconnect [count]                  in-process server, ws and wss" << std::endl
+			  << "  reconnect <url> <token> [count]" << std::endl
+			  << "  transport [count] [size]" << std::endl
+			  << "  deflate [count] [size]" << std::endl
+			  << "  latency [count] [interval us]" << std::endl
+			  << "  spin [count] [interval us]" << std::endl
+			  << "  drive [count] [interval us]" << std::endl
+			  << "  pool [connections] [count per connection] [size]" << std::endl
+			  << "  engine [connections] [cores] [count per connection] [size]" << std::endl
+			  << "  shards [count] [channels]" << std::endl
+			  << "  fanout [subscribers] [count] [size]" << std::endl
+			  << "  relay [clients] [count] [size]" << std::endl
+			  << "  ktls [count] [size]" << std::endl
+			  << "  handoff [count] [interval ns]" << std::endl
+			  << "  consumers [count] [size]" << std::endl
+			  << "  backpressure [count] [size] [budget bytes]" << std::endl
+			  << "  conflate [count] [channels]" << std::endl
+			  << "  priority [count] [bulk channels]" << std::endl
+			  << "  route [count] [channels]" << std::endl
+			  << "  batch [count] [size]" << std::endl
+			  << "  stream [count] [size]" << std::endl
+			  << "  buffers [count] [size]" << std::endl;
+
+	return 1;
+}
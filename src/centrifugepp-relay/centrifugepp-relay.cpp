@@ -0,0 +1,100 @@
+﻿#include <iostream>
+#include <optional>
+#include <string_view>
+
+#if defined( __unix__ ) || defined( __APPLE__ )
+#include <unistd.h>
+#endif
+
+#include "boost/asio/signal_set.hpp"
+
+#include "centrifugepp/centrifugeClient.hpp"
+
+#include "relayServer.hpp"
+
+
+/// one upstream connection re-published to the local clients of a host, e.g.
+///
+///		centrifugepp-relay wss://example.com/connection/websocket 127.0.0.1:8001 <token>
+///		centrifugepp-relay wss://example.com/connection/websocket unix:/run/centrifugo.sock <token>
+///
+/// local clients connect to ws://127.0.0.1:8001/ or ws+unix:///run/centrifugo.sock and are not authenticated
+int main( int argc, char * argv[] )
+{
+	if ( argc < 3 ) {
+		std::clog << "usage: " << argv[0] << " <upstream-url> <host:port | unix:path> [token]" << std::endl;
+		return 1;
+	}
+
+	try {
+		const std::string_view listen = argv[2];
+		const as::t_string token = argc > 3 ? argv[3] : "";
+
+		boost::asio::io_context io( 1 );
+
+		std::optional<relay::RelayHub> hub;
+
+		as::CentrifugeClient client(
+			argv[1],
+			[&token] { return token; },
+			[&hub]( as::CentrifugeClientBase & ) { hub->resubscribe(); },
+			[]( as::CentrifugeClientBase &, const std::string_view, const std::string_view ) {} );
+
+		hub.emplace( client );
+
+		std::optional<relay::RelayServer<boost::asio::ip::tcp>> tcpServer;
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+		std::optional<relay::RelayServer<boost::asio::local::stream_protocol>> unixServer;
+#endif
+
+		if ( listen.starts_with( "unix:" ) ) {
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+			std::string path( listen.substr( 5 ) );
+			::unlink( path.c_str() );
+			unixServer.emplace( io, boost::asio::local::stream_protocol::endpoint( path ), *hub );
+#else
+			std::clog << "unix domain sockets are not supported on this platform" << std::endl;
+			return 1;
+#endif
+		}
+		else {
+			auto colon = listen.rfind( ':' );
+
+			if ( std::string_view::npos == colon ) {
+				std::clog << "listen address has no port: " << listen << std::endl;
+				return 1;
+			}
+
+			auto address = boost::asio::ip::make_address( std::string( listen.substr( 0, colon ) ) );
+			auto port = static_cast<unsigned short>( std::stoul( std::string( listen.substr( colon + 1 ) ) ) );
+
+			tcpServer.emplace( io, boost::asio::ip::tcp::endpoint( address, port ), *hub );
+		}
+
+		boost::asio::signal_set signals( io, SIGINT, SIGTERM );
+
+		signals.async_wait( [&]( boost::system::error_code, int ) {
+			client.stop();
+
+			if ( tcpServer ) {
+				tcpServer->close();
+			}
+
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+			if ( unixServer ) {
+				unixServer->close();
+			}
+#endif
+		} );
+
+		// the local sessions share the io thread of the upstream connection, nothing is handed between threads
+		client.start( io );
+		io.run();
+	}
+	catch ( const std::exception & x ) {
+		std::cerr << x.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,417 @@
+﻿#ifndef __CENTRIFUGEPP_RELAY__RELAY_SERVER__H
+#define __CENTRIFUGEPP_RELAY__RELAY_SERVER__H
+
+
+#include <list>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+#include "boost/asio/ip/tcp.hpp"
+#include "boost/asio/local/stream_protocol.hpp"
+
+#include "boost/beast/core.hpp"
+#include "boost/beast/websocket.hpp"
+
+#include "protocol/client.pb.h"
+
+#include "centrifugepp/centrifugeClient.hpp"
+#include "centrifugepp/fanOut.hpp"
+
+
+namespace relay {
+
+	namespace protocol = centrifugal::centrifuge::protocol;
+
+
+	using t_frame = std::shared_ptr<const std::string>;
+
+
+	struct t_relayOptions {
+		/// a local client that lets more than this wait for its socket is disconnected
+		size_t maxQueuedBytes = 16 * 1024 * 1024;
+	};
+
+
+	class RelaySessionBase {
+	public:
+		virtual ~RelaySessionBase() = default;
+		virtual void send( const t_frame & frame ) = 0;
+		virtual void close() = 0;
+	};
+
+
+	/// local subscriptions on top of the upstream ones: a channel is subscribed upstream while a local client wants
+	/// it, every publication is serialized once and the same frame is queued to all its local subscribers
+	///
+	/// a local client gets a push with the channel and the data of the publication only: offset, info, tags and time
+	/// are not forwarded, the client library hands over the payload alone. Upstream subscriptions do not ask for
+	/// delta compression, so data is always the full payload and delta is never set
+	///
+	/// io thread of the upstream client, the local sessions run on the same one
+	class RelayHub {
+	protected:
+		struct t_channel {
+			as::t_subscriberId upstream = as::FanOut::InvalidId;
+			std::vector<RelaySessionBase *> sessions;
+		};
+
+	protected:
+		as::FanOut m_fanOut;
+		std::unordered_map<as::t_string, t_channel> m_channels;
+
+		protocol::Reply m_reply;
+		size_t m_publicationCount = 0;
+
+	protected:
+		void publish( t_channel & ch, const std::string_view name, const as::SharedBuffer & data )
+		{
+			auto push = m_reply.mutable_push();
+			push->set_channel( name.data(), name.size() );
+			push->mutable_pub()->set_data( data.Data(), data.Size() );
+
+			auto frame = std::make_shared<std::string>();
+			as::CentrifugeClientBase::serialize( *frame, m_reply );
+			++m_publicationCount;
+
+			// a session that overflows leaves while the list is walked
+			auto sessions = ch.sessions;
+
+			for ( auto session : sessions ) {
+				session->send( frame );
+			}
+		}
+
+	public:
+		explicit RelayHub( as::CentrifugeClientBase & upstream )
+			: m_fanOut( upstream )
+		{
+		}
+
+
+		/// from the connect handler of the upstream client
+		void resubscribe()
+		{
+			m_fanOut.resubscribe();
+		}
+
+
+		void join( RelaySessionBase & session, const as::t_stringview channel )
+		{
+			auto & ch = m_channels[as::t_string( channel )];
+
+			if ( std::find( ch.sessions.begin(), ch.sessions.end(), &session ) != ch.sessions.end() ) {
+				return;
+			}
+
+			ch.sessions.push_back( &session );
+
+			if ( as::FanOut::InvalidId == ch.upstream ) {
+				ch.upstream = m_fanOut.subscribe( channel,
+					[this, &ch]( as::CentrifugeClientBase &,
+						as::t_channelId,
+						const std::string_view name,
+						const as::SharedBuffer & data ) { publish( ch, name, data ); } );
+			}
+		}
+
+
+		void leave( RelaySessionBase & session, const as::t_stringview channel )
+		{
+			auto it = m_channels.find( as::t_string( channel ) );
+
+			if ( m_channels.end() == it ) {
+				return;
+			}
+
+			auto & ch = it->second;
+			std::erase( ch.sessions, &session );
+
+			if ( ch.sessions.empty() && ch.upstream != as::FanOut::InvalidId ) {
+				m_fanOut.unsubscribe( ch.upstream );
+				ch.upstream = as::FanOut::InvalidId;
+			}
+		}
+
+
+		/// publications serialized for the local clients
+		size_t PublicationCount() const
+		{
+			return m_publicationCount;
+		}
+
+
+		/// channels subscribed upstream
+		size_t UpstreamCount() const
+		{
+			return m_fanOut.UpstreamCount();
+		}
+	};
+
+
+	/// one local client: answers connect/subscribe/unsubscribe, writes the shared frames in order
+	template <typename T_stream>
+	class RelaySession : public RelaySessionBase, public std::enable_shared_from_this<RelaySession<T_stream>> {
+	protected:
+		const t_relayOptions & m_options;
+		RelayHub & m_hub;
+
+		T_stream m_stream;
+		boost::beast::flat_buffer m_buffer;
+
+		std::deque<t_frame> m_queue;
+		size_t m_queuedBytes = 0;
+		bool m_isWriting = false;
+
+		/// what is queued goes out as one websocket message, replies are length-delimited
+		std::vector<t_frame> m_writing;
+		std::vector<boost::asio::const_buffer> m_buffers;
+		bool m_isClosed = false;
+
+		std::vector<as::t_string> m_channels;
+
+	protected:
+		void readAsync()
+		{
+			m_stream.async_read( m_buffer, [self = this->shared_from_this()]( boost::system::error_code ec, size_t ) {
+				if ( ec ) {
+					self->close();
+					return;
+				}
+
+				self->OnCommands( static_cast<const char *>( self->m_buffer.data().data() ), self->m_buffer.size() );
+				self->m_buffer.consume( self->m_buffer.size() );
+
+				self->readAsync();
+			} );
+		}
+
+
+		void OnCommands( const char * data, size_t size )
+		{
+			std::string frame;
+			as::t_buffer b( const_cast<char *>( data ), size );
+
+			while ( size > 0 ) {
+				auto s = as::CentrifugeClientBase::decodeLength( b );
+
+				if ( s + b.len > size ) {
+					break;
+				}
+
+				protocol::Command command;
+				command.ParseFromArray( b.ptr + b.len, static_cast<int>( s ) );
+
+				size -= s + b.len;
+				b.ptr += s + b.len;
+				b.len = size;
+
+				protocol::Reply reply;
+				reply.set_id( command.id() );
+
+				if ( command.has_connect() ) {
+					reply.mutable_connect()->set_client( "relay" );
+				}
+				else if ( command.has_subscribe() ) {
+					reply.mutable_subscribe();
+
+					const auto & channel = command.subscribe().channel();
+
+					if ( std::find( m_channels.begin(), m_channels.end(), channel ) == m_channels.end() ) {
+						m_channels.push_back( channel );
+						m_hub.join( *this, channel );
+					}
+				}
+				else if ( command.has_unsubscribe() ) {
+					reply.mutable_unsubscribe();
+
+					const auto & channel = command.unsubscribe().channel();
+					std::erase( m_channels, channel );
+					m_hub.leave( *this, channel );
+				}
+				else {
+					continue;
+				}
+
+				std::string message;
+				as::CentrifugeClientBase::serialize( message, reply );
+				frame += message;
+			}
+
+			if ( !frame.empty() ) {
+				send( std::make_shared<const std::string>( std::move( frame ) ) );
+			}
+		}
+
+
+		void writeNext()
+		{
+			if ( m_queue.empty() || m_isClosed ) {
+				m_isWriting = false;
+				return;
+			}
+
+			m_isWriting = true;
+
+			m_writing.clear();
+			m_buffers.clear();
+
+			while ( !m_queue.empty() ) {
+				m_buffers.push_back( boost::asio::buffer( *m_queue.front() ) );
+				m_writing.push_back( std::move( m_queue.front() ) );
+				m_queue.pop_front();
+			}
+
+			m_stream.async_write(
+				m_buffers, [self = this->shared_from_this()]( boost::system::error_code ec, size_t bytes ) {
+					if ( ec ) {
+						self->close();
+						return;
+					}
+
+					self->m_queuedBytes -= bytes;
+					self->writeNext();
+				} );
+		}
+
+	public:
+		template <typename... T_args>
+		RelaySession( const t_relayOptions & options, RelayHub & hub, T_args &&... args )
+			: m_options( options )
+			, m_hub( hub )
+			, m_stream( std::forward<T_args>( args )... )
+		{
+		}
+
+
+		void start()
+		{
+			m_stream.binary( true );
+			m_stream.set_option( boost::beast::websocket::stream_base::decorator(
+				[]( boost::beast::websocket::response_type & res ) {
+					res.set( boost::beast::http::field::sec_websocket_protocol, "centrifuge-protobuf" );
+				} ) );
+
+			m_stream.async_accept( [self = this->shared_from_this()]( boost::system::error_code ec ) {
+				if ( !ec ) {
+					self->readAsync();
+				}
+			} );
+		}
+
+
+		void send( const t_frame & frame ) override
+		{
+			if ( m_isClosed ) {
+				return;
+			}
+
+			if ( m_queuedBytes + frame->size() > m_options.maxQueuedBytes ) {
+				AS_LOG_WARN_LINE( "relay: local client too slow, disconnected" );
+				close();
+				return;
+			}
+
+			m_queue.push_back( frame );
+			m_queuedBytes += frame->size();
+
+			if ( !m_isWriting ) {
+				writeNext();
+			}
+		}
+
+
+		/// leaves all channels, the session goes away with its last pending operation
+		void close() override
+		{
+			if ( m_isClosed ) {
+				return;
+			}
+
+			m_isClosed = true;
+
+			for ( const auto & channel : m_channels ) {
+				m_hub.leave( *this, channel );
+			}
+
+			m_channels.clear();
+
+			boost::system::error_code ec;
+			boost::beast::get_lowest_layer( m_stream ).close( ec );
+		}
+	};
+
+
+	/// accepts local websocket clients over TCP or a unix domain socket, on the io context of the upstream client
+	template <typename T_protocol> class RelayServer {
+	protected:
+		using t_socket = typename T_protocol::socket;
+		using t_stream = boost::beast::websocket::stream<t_socket>;
+
+	protected:
+		t_relayOptions m_options;
+		RelayHub & m_hub;
+
+		typename T_protocol::acceptor m_acceptor;
+		std::list<std::weak_ptr<RelaySessionBase>> m_sessions;
+
+	protected:
+		void acceptAsync()
+		{
+			m_acceptor.async_accept( [this]( boost::system::error_code ec, t_socket socket ) {
+				if ( ec ) {
+					return;
+				}
+
+				m_sessions.remove_if( []( const auto & session ) { return session.expired(); } );
+
+				auto session = std::make_shared<RelaySession<t_stream>>( m_options, m_hub, std::move( socket ) );
+				m_sessions.push_back( session );
+				session->start();
+
+				acceptAsync();
+			} );
+		}
+
+	public:
+		RelayServer( boost::asio::io_context & io,
+			const typename T_protocol::endpoint & endpoint,
+			RelayHub & hub,
+			const t_relayOptions & options = {} )
+			: m_options( options )
+			, m_hub( hub )
+			, m_acceptor( io, endpoint )
+		{
+			acceptAsync();
+		}
+
+
+		typename T_protocol::endpoint Endpoint() const
+		{
+			return m_acceptor.local_endpoint();
+		}
+
+
+		/// io thread, stops accepting and disconnects the local clients
+		void close()
+		{
+			boost::system::error_code ec;
+			m_acceptor.close( ec );
+
+			for ( auto & p : m_sessions ) {
+				if ( auto session = p.lock() ) {
+					session->close();
+				}
+			}
+
+			m_sessions.clear();
+		}
+	};
+
+} // namespace relay
+
+
+#endif
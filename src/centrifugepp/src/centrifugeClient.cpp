@@ -31,6 +31,124 @@
 
 namespace as {
 
+	namespace {
+
+		int64_t nowNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch() )
+				.count();
+		}
+
+
+		bool readVarint( const t_byte *& p, const t_byte * end, uint64_t & v )
+		{
+			v = 0;
+
+			for ( size_t shift = 0; p < end && shift < 64; shift += 7 ) {
+				auto byte = *p++;
+				v |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+
+				if ( ( byte & 0x80 ) == 0 ) {
+					return true;
+				}
+			}
+
+			return false;
+		}
+
+
+		/// first length-delimited field number of a serialized message, nothing is decoded
+		bool findField( const t_byte * p, const t_byte * end, uint64_t number, std::string_view & out )
+		{
+			while ( p < end ) {
+				uint64_t key;
+				uint64_t v;
+
+				if ( !readVarint( p, end, key ) ) {
+					return false;
+				}
+
+				switch ( key & 7 ) {
+					case 0:
+						if ( !readVarint( p, end, v ) ) {
+							return false;
+						}
+
+						break;
+
+					case 1:
+						if ( end - p < 8 ) {
+							return false;
+						}
+
+						p += 8;
+						break;
+
+					case 2:
+						if ( !readVarint( p, end, v ) || v > static_cast<uint64_t>( end - p ) ) {
+							return false;
+						}
+
+						if ( key >> 3 == number ) {
+							out = std::string_view( reinterpret_cast<const char *>( p ), v );
+							return true;
+						}
+
+						p += v;
+						break;
+
+					case 5:
+						if ( end - p < 4 ) {
+							return false;
+						}
+
+						p += 4;
+						break;
+
+					default:
+						return false;
+				}
+			}
+
+			return false;
+		}
+
+
+		bool findField( const std::string_view message, uint64_t number, std::string_view & out )
+		{
+			auto p = reinterpret_cast<const t_byte *>( message.data() );
+			return findField( p, p + message.size(), number, out );
+		}
+
+	} // namespace
+
+
+	/// Reply.push (4) -> Push.pub (4) -> Publication.channel (10), Push.channel (2) when the former is empty;
+	/// payload: Publication.data (4)
+	bool CentrifugeClientBase::peekPublication(
+		const t_byte * data, size_t size, std::string_view & channel, std::string_view & payload )
+	{
+		std::string_view push;
+		std::string_view pub;
+
+		if ( !findField( data, data + size, 4, push ) || !findField( push, 4, pub ) ) {
+			return false;
+		}
+
+		if ( !findField( pub, 10, channel ) || channel.empty() ) {
+			channel = {};
+			findField( push, 2, channel );
+		}
+
+		if ( !findField( pub, 4, payload ) ) {
+			payload = {};
+		}
+
+		return true;
+	}
+
+
 	void CentrifugeClientBase::wsHandshakeHandler( as::WsClientBase & client )
 	{
 		try {
@@ -71,31 +189,57 @@ namespace as {
 
 				AS_LOG_DEBUG_LINE( "Size: " << s << " Len size: " << b.len );
 
-				centrifugal::centrifuge::protocol::Reply reply;
-				reply.ParseFromArray( b.ptr + b.len, s );
-				AS_LOG_DEBUG_LINE(
-					"Reply: has error: " << reply.has_error() << " has subscribe: " << reply.has_subscribe()
-										 << " has push: " << reply.has_push() << " has ping: " << reply.has_ping() );
+				auto message = b.ptr + b.len;
 
-				if ( reply.has_error() ) {
-					AS_LOG_ERROR_LINE( reply.error().message() );
-				}
-				else if ( reply.has_connect() ) {
-					AS_LOG_DEBUG_LINE( "Connect" );
-					OnConnect( *this );
-				}
-				else if ( reply.has_subscribe() ) {
-					AS_LOG_DEBUG_LINE( "Subscribed" );
+				std::string_view channel;
+				std::string_view payload;
+
+				// publications are read straight off the wire, the payload is copied once, into a pooled buffer
+				if ( peekPublication( message, s, channel, payload ) ) {
+					AS_LOG_DEBUG_LINE( "Pub: channel: " << channel << " data: " << payload );
+
+					t_publication pub;
+					pub.channelId = m_channels.intern( channel );
+					pub.channel = m_channels.Name( pub.channelId );
+					pub.data = m_pool->copy( payload.data(), payload.size() );
+
+					accept( client, std::move( pub ) );
 				}
-				else if ( reply.has_push() ) {
-					AS_LOG_DEBUG_LINE(
-						"Push: has message: " << reply.push().has_message() << " has pub: " << reply.push().has_pub() );
+				else {
+					centrifugal::centrifuge::protocol::Reply reply;
+					reply.ParseFromArray( message, s );
+					AS_LOG_DEBUG_LINE( "Reply: has error: " << reply.has_error() << " has subscribe: "
+															<< reply.has_subscribe() << " has push: " << reply.has_push()
+															<< " has ping: " << reply.has_ping() );
+
+					if ( reply.has_error() ) {
+						AS_LOG_ERROR_LINE( reply.error().message() );
+					}
+					else if ( reply.has_connect() ) {
+						AS_LOG_DEBUG_LINE( "Connect" );
+						m_isSessionEstablished = true;
+						OnConnect( *this );
+					}
+					else if ( reply.has_subscribe() ) {
+						AS_LOG_DEBUG_LINE( "Subscribed" );
+					}
+					else if ( reply.has_push() ) {
+						AS_LOG_DEBUG_LINE( "Push: has message: " << reply.push().has_message()
+															<< " has pub: " << reply.push().has_pub() );
 
-					if ( reply.push().has_pub() ) {
-						AS_LOG_DEBUG_LINE( "Pub: channel: " << reply.push().pub().channel()
-															<< " data: " << reply.push().pub().data() );
+						// only a reply peekPublication() cannot walk gets here (group fields); the channel is resolved
+						// the same way
+						if ( reply.push().has_pub() ) {
+							const auto & p = reply.push().pub();
+							const auto & channel = p.channel().empty() ? reply.push().channel() : p.channel();
 
-						OnPub( *this, reply.push().pub().channel(), reply.push().pub().data() );
+							t_publication pub;
+							pub.channelId = m_channels.intern( channel );
+							pub.channel = m_channels.Name( pub.channelId );
+							pub.data = m_pool->copy( p.data().data(), p.data().size() );
+
+							accept( client, std::move( pub ) );
+						}
 					}
 				}
 
@@ -104,6 +248,12 @@ namespace as {
 				b.len = size;
 			}
 			while ( size > 0 );
+
+			if ( 0 == m_batchOptions.windowUs ) {
+				flushBatch();
+			}
+
+			applyBudget( client );
 		}
 		catch ( const std::exception & e ) {
 			AS_LOG_ERROR_LINE( e.what() );
@@ -116,8 +266,433 @@ namespace as {
 	}
 
 
+	/// shared io context, io thread
+	void CentrifugeClientBase::startSession()
+	{
+		if ( !m_isRunning ) {
+			finish();
+			return;
+		}
+
+		m_isSessionEstablished = false;
+		m_isSessionRunning = true;
+
+		m_wsClient->Id( std::to_string( ++m_connectionCount ) );
+		m_wsClient->start( [this] { OnSessionStopped(); } );
+	}
+
+
+	void CentrifugeClientBase::OnSessionStopped()
+	{
+		m_isSessionRunning = false;
+
+		// a window still open when the connection dropped
+		flushBatch();
+
+		if ( !m_isRunning ) {
+			finish();
+			return;
+		}
+
+		// an established session is restored at once, failed attempts are throttled
+		m_reconnectTimer->expires_after( std::chrono::milliseconds( m_isSessionEstablished ? 0 : m_reconnectDelayMs ) );
+		m_reconnectTimer->async_wait( [this]( boost::system::error_code ) { startSession(); } );
+	}
+
+
+	void CentrifugeClientBase::finish()
+	{
+		stopConsumers();
+		closeSubscriptions();
+
+		// the owner may destroy the client as soon as the handler has signalled
+		auto handler = std::move( m_stoppedHandler );
+		AS_CALL( handler );
+	}
+
+
+	void CentrifugeClientBase::startConsumers()
+	{
+		// a stream is fed and drained on the io thread, a consumer thread must not push into it
+		if ( m_delivery.consumers > 0 && !m_subscriptions.empty() ) {
+			AS_LOG_ERROR_LINE( "stream() needs queued delivery off (consumers = 0), its subscriptions are closed" );
+			closeSubscriptions();
+		}
+
+		for ( size_t i = 0; i < m_delivery.consumers; ++i ) {
+			auto & consumer = *m_consumers.emplace_back( std::make_unique<t_consumer>() );
+
+			for ( auto & ring : consumer.rings ) {
+				ring = std::make_unique<SpscRing<t_publication>>(
+					m_delivery.capacity, m_delivery.waitStrategy, &consumer.bell );
+			}
+
+			auto cpu = m_delivery.cpus.empty() ? -1 : m_delivery.cpus[i % m_delivery.cpus.size()];
+
+			consumer.thread = std::thread( [this, &consumer, cpu] {
+				if ( cpu >= 0 && !pinThread( cpu ) ) {
+					AS_LOG_WARN_LINE( "consumer: cannot pin to cpu " << cpu );
+				}
+
+				consume( consumer );
+			} );
+		}
+	}
+
+
+	/// waiting coroutines resume with an empty publication
+	void CentrifugeClientBase::closeSubscriptions()
+	{
+		for ( auto & sub : m_subscriptions ) {
+			sub.close();
+		}
+	}
+
+
+	/// consumers drain what is already queued before they exit
+	void CentrifugeClientBase::stopConsumers()
+	{
+		for ( auto & consumer : m_consumers ) {
+			for ( auto & ring : consumer->rings ) {
+				ring->close();
+			}
+		}
+
+		for ( auto & consumer : m_consumers ) {
+			consumer->thread.join();
+		}
+
+		m_consumers.clear();
+
+		for ( auto & slot : m_slots ) {
+			delete slot.pending.exchange( nullptr );
+		}
+	}
+
+
+	/// to its handler on the io thread, or to the consumers
+	void CentrifugeClientBase::accept( as::WsClientBase & client, t_publication && pub )
+	{
+		if ( !m_consumers.empty() ) {
+			deliver( std::move( pub ) );
+			return;
+		}
+
+		auto route = m_router.resolve( pub.channelId, pub.channel );
+
+		if ( nullptr == route && m_batchHandler ) {
+			gather( client, std::move( pub ) );
+		}
+		else {
+			dispatch( route, pub.channelId, pub.channel, pub.data );
+		}
+	}
+
+
+	/// io thread delivery
+	void CentrifugeClientBase::gather( as::WsClientBase & client, t_publication && pub )
+	{
+		if ( m_batch.empty() ) {
+			m_batchStartNs = nowNs();
+
+			if ( m_batchOptions.windowUs > 0 ) {
+				client.deferAsync( m_batchOptions.windowUs, [this] { flushBatch(); } );
+			}
+		}
+
+		m_batch.push_back( std::move( pub ) );
+
+		if ( isBatchFull( m_batch ) ) {
+			flushBatch();
+		}
+	}
+
+
+	void CentrifugeClientBase::flushBatch()
+	{
+		if ( m_batch.empty() ) {
+			return;
+		}
+
+		try {
+			deliverBatch( m_batch, m_batchViews );
+		}
+		catch ( const std::exception & e ) {
+			AS_LOG_ERROR_LINE( e.what() );
+		}
+		catch ( ... ) {
+			AS_LOG_ERROR_LINE( "Unknown exception" );
+		}
+	}
+
+
+	/// batch is empty afterwards, also when the handler throws
+	void CentrifugeClientBase::deliverBatch( std::vector<t_publication> & batch, std::vector<t_pubView> & views )
+	{
+		views.clear();
+
+		for ( const auto & pub : batch ) {
+			views.push_back( { pub.channelId, pub.channel, pub.data.View(), &pub.data } );
+		}
+
+		try {
+			m_batchHandler( *this, views );
+		}
+		catch ( ... ) {
+			batch.clear();
+			throw;
+		}
+
+		batch.clear();
+	}
+
+
+	/// the next publication in class order, the latest one for a conflation slot; false when all rings are empty
+	bool CentrifugeClientBase::take( t_consumer & consumer, t_publication & pub )
+	{
+		for ( ;; ) {
+			bool isPopped = false;
+
+			for ( auto & ring : consumer.rings ) {
+				if ( ( isPopped = ring->tryPop( pub ) ) ) {
+					break;
+				}
+			}
+
+			if ( !isPopped ) {
+				return false;
+			}
+
+			if ( nullptr == pub.slot ) {
+				return true;
+			}
+
+			std::unique_ptr<t_publication> latest( pub.slot->pending.exchange( nullptr ) );
+
+			if ( latest ) {
+				pub = std::move( *latest );
+				return true;
+			}
+		}
+	}
+
+
+	void CentrifugeClientBase::consume( t_consumer & consumer )
+	{
+		t_publication pub;
+		std::vector<t_publication> batch;
+		std::vector<t_pubView> views;
+
+		auto isAvailable = [&consumer] {
+			for ( const auto & ring : consumer.rings ) {
+				if ( !ring->IsEmpty() ) {
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+		auto isClosed = [&consumer] { return consumer.rings[0]->IsClosed(); };
+
+		while ( consumer.bell.wait( m_delivery.waitStrategy, isAvailable, isClosed ) ) {
+			// one publication at a time, the classes are looked at again from the top for the next one; batched
+			// publications are handed over once the rings are drained or the batch is full
+			size_t batchBytes = 0;
+
+			while ( !isBatchFull( batch ) && take( consumer, pub ) ) {
+				auto bytes = pub.channel.size() + pub.data.Size();
+				countDelivery( pub.receivedNs );
+
+				if ( nullptr == pub.route && m_batchHandler ) {
+					batchBytes += bytes;
+					batch.push_back( std::move( pub ) );
+
+					continue;
+				}
+
+				try {
+					dispatch( pub.route, pub.channelId, pub.channel, pub.data );
+				}
+				catch ( const std::exception & e ) {
+					AS_LOG_ERROR_LINE( e.what() );
+				}
+				catch ( ... ) {
+					AS_LOG_ERROR_LINE( "Unknown exception" );
+				}
+
+				release( bytes );
+			}
+
+			if ( batch.empty() ) {
+				continue;
+			}
+
+			try {
+				deliverBatch( batch, views );
+			}
+			catch ( const std::exception & e ) {
+				AS_LOG_ERROR_LINE( e.what() );
+			}
+			catch ( ... ) {
+				AS_LOG_ERROR_LINE( "Unknown exception" );
+			}
+
+			release( batchBytes );
+		}
+	}
+
+
+	void CentrifugeClientBase::dispatch( const t_pubRoute * route,
+		t_channelId channelId,
+		const std::string_view channelName,
+		const SharedBuffer & data )
+	{
+		if ( route != nullptr ) {
+			( *route )( *this, channelId, channelName, data );
+		}
+		else {
+			OnPub( *this, channelId, channelName, data );
+		}
+	}
+
+
+	void CentrifugeClientBase::deliver( t_publication && pub )
+	{
+		// dense ids spread channels over the consumers evenly
+		auto & consumer = *m_consumers[pub.channelId % m_consumers.size()];
+		auto cls = priority( pub.channelId );
+		auto & ring = *consumer.rings[static_cast<size_t>( cls )];
+		auto bytes = pub.channel.size() + pub.data.Size();
+
+		auto queued = m_queuedBytes.fetch_add( bytes ) + bytes;
+		m_peakQueuedBytes = std::max( m_peakQueuedBytes, queued );
+
+		pub.receivedNs = nowNs();
+		pub.route = m_router.resolve( pub.channelId, pub.channel );
+
+		if ( conflate( pub ) ) {
+			return;
+		}
+
+		// a conflation notification is never shed, its slot would not be announced again
+		if ( nullptr == pub.slot && shed( ring, cls ) ) {
+			m_queuedBytes -= bytes;
+			++m_shedCount;
+
+			return;
+		}
+
+		if ( !ring.push( std::move( pub ) ) ) {
+			m_queuedBytes -= bytes;
+			AS_LOG_WARN_LINE( "publication dropped, delivery is stopped" );
+		}
+	}
+
+
+	t_priority CentrifugeClientBase::priority( t_channelId id ) const
+	{
+		return id < m_priorities.size() ? m_priorities[id] : t_priority::Normal;
+	}
+
+
+	/// io thread, the single producer, so a ring that is not full stays so until the push
+	bool CentrifugeClientBase::shed( const SpscRing<t_publication> & ring, t_priority priority )
+	{
+		auto index = static_cast<size_t>( priority );
+		const auto & o = m_delivery.priorities[index];
+
+		if ( t_shedPolicy::Block == o.policy ) {
+			return false;
+		}
+
+		auto threshold = std::min( o.overloadItems > 0 ? o.overloadItems : ring.Capacity() / 2, ring.Capacity() );
+
+		if ( ring.Size() < threshold ) {
+			return false;
+		}
+
+		if ( t_shedPolicy::Drop == o.policy ) {
+			return true;
+		}
+
+		return m_sampleCounters[index]++ % std::max<size_t>( o.sampleEvery, 1 ) != 0;
+	}
+
+
+	/// parks pub in the slot of a conflated channel, true when the ring already carries that slot; otherwise pub is
+	/// turned into the notification for it
+	bool CentrifugeClientBase::conflate( t_publication & pub )
+	{
+		if ( pub.channelId >= m_conflation.size() || nullptr == m_conflation[pub.channelId] ) {
+			return false;
+		}
+
+		auto slot = m_conflation[pub.channelId];
+		std::unique_ptr<t_publication> replaced( slot->pending.exchange( new t_publication( std::move( pub ) ) ) );
+
+		if ( replaced ) {
+			++m_conflatedCount;
+			m_queuedBytes -= replaced->channel.size() + replaced->data.Size();
+
+			return true;
+		}
+
+		auto channelId = pub.channelId;
+
+		pub = {};
+		pub.channelId = channelId;
+		pub.slot = slot;
+
+		return false;
+	}
+
+
+	void CentrifugeClientBase::countDelivery( int64_t receivedNs )
+	{
+		auto lagNs = nowNs() - receivedNs;
+
+		++m_deliveredCount;
+		m_lagTotalNs += lagNs;
+
+		auto maxNs = m_lagMaxNs.load();
+
+		while ( lagNs > maxNs && !m_lagMaxNs.compare_exchange_weak( maxNs, lagNs ) ) {
+		}
+	}
+
+
+	/// consumer side
+	void CentrifugeClientBase::release( size_t bytes )
+	{
+		auto queued = m_queuedBytes.fetch_sub( bytes ) - bytes;
+
+		if ( m_delivery.budgetBytes > 0 && queued <= lowWatermark() && m_wsClient && m_wsClient->IsReadPaused() ) {
+			m_wsClient->resumeRead();
+		}
+	}
+
+
+	/// io thread, after a frame is handed over
+	void CentrifugeClientBase::applyBudget( as::WsClientBase & client )
+	{
+		if ( 0 == m_delivery.budgetBytes || m_queuedBytes <= m_delivery.budgetBytes || client.IsReadPaused() ) {
+			return;
+		}
+
+		client.pauseRead();
+
+		// the consumers may have drained below the watermark before they could see the pause
+		if ( m_queuedBytes <= lowWatermark() ) {
+			client.resumeRead();
+		}
+	}
+
+
 	void CentrifugeClientBase::subscribe( const as::t_stringview channel )
 	{
+		m_channels.intern( channel );
+
 		centrifugal::centrifuge::protocol::Command command;
 		command.set_id( m_messageId.fetch_add( 1 ) );
 		auto sub = command.mutable_subscribe();
@@ -127,4 +702,44 @@ namespace as {
 		m_wsClient->write( message.data(), message.size() );
 	}
 
+
+	void CentrifugeClientBase::unsubscribe( const as::t_stringview channel )
+	{
+		centrifugal::centrifuge::protocol::Command command;
+		command.set_id( m_messageId.fetch_add( 1 ) );
+		auto unsub = command.mutable_unsubscribe();
+		unsub->set_channel( channel.data(), channel.size() );
+		std::string message;
+		serialize( message, command );
+		m_wsClient->write( message.data(), message.size() );
+	}
+
+
+	void CentrifugeClientBase::subscribe( const as::t_stringview channel, t_priority priority )
+	{
+		auto id = m_channels.intern( channel );
+
+		if ( id >= m_priorities.size() ) {
+			m_priorities.resize( id + 1, t_priority::Normal );
+		}
+
+		m_priorities[id] = priority;
+
+		subscribe( channel );
+	}
+
+
+	void CentrifugeClientBase::conflate( const as::t_stringview channel )
+	{
+		auto id = m_channels.intern( channel );
+
+		if ( id >= m_conflation.size() ) {
+			m_conflation.resize( id + 1, nullptr );
+		}
+
+		if ( nullptr == m_conflation[id] ) {
+			m_conflation[id] = &m_slots.emplace_back();
+		}
+	}
+
 } // namespace as
@@ -0,0 +1,150 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// engine.cpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#include "centrifugepp/core.hpp"
+#include "centrifugepp/logger.hpp"
+#include "centrifugepp/affinity.hpp"
+
+#include "centrifugepp/engine.hpp"
+
+
+namespace as {
+
+	Engine::Engine( const t_engineOptions & options )
+	{
+		auto cpus = options.cpus;
+
+		if ( cpus.empty() ) {
+			for ( unsigned i = 0, n = std::max( std::thread::hardware_concurrency(), 1u ); i < n; ++i ) {
+				cpus.push_back( static_cast<int>( i ) );
+			}
+		}
+
+		for ( auto cpu : cpus ) {
+			auto & core = m_cores.emplace_back();
+			core.cpu = cpu;
+			core.work.emplace( core.io.get_executor() );
+		}
+
+		for ( auto & core : m_cores ) {
+			core.thread = std::thread( [&core] {
+				if ( core.cpu >= 0 && !pinThread( core.cpu ) ) {
+					AS_LOG_WARN_LINE( "engine: cannot pin to cpu " << core.cpu );
+				}
+
+				core.io.run();
+			} );
+		}
+	}
+
+
+	Engine::~Engine()
+	{
+		stop();
+
+		for ( auto & core : m_cores ) {
+			core.work.reset();
+			core.thread.join();
+		}
+	}
+
+
+	size_t Engine::add( CentrifugeClientBase & client, size_t core )
+	{
+		std::list<t_client>::iterator it;
+
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			if ( AnyCore == core ) {
+				core = 0;
+
+				for ( size_t i = 1; i < m_cores.size(); ++i ) {
+					if ( m_cores[i].clients < m_cores[core].clients ) {
+						core = i;
+					}
+				}
+			}
+
+			++m_cores[core].clients;
+			it = m_clients.insert( m_clients.end(), { &client, core } );
+		}
+
+		client.start( m_cores[core].io, [this, it] { OnClientStopped( it ); } );
+
+		return core;
+	}
+
+
+	/// core thread
+	void Engine::OnClientStopped( std::list<t_client>::iterator it )
+	{
+		std::lock_guard<std::mutex> lock( m_sync );
+
+		--m_cores[it->core].clients;
+		m_clients.erase( it );
+
+		m_stopped.notify_all();
+	}
+
+
+	void Engine::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_sync );
+
+			for ( auto & c : m_clients ) {
+				c.client->stop();
+			}
+		}
+
+		wait();
+	}
+
+
+	void Engine::wait()
+	{
+		std::unique_lock<std::mutex> lock( m_sync );
+		m_stopped.wait( lock, [this] { return m_clients.empty(); } );
+	}
+
+
+	void Engine::sync()
+	{
+		std::vector<std::future<void>> done;
+
+		for ( auto & core : m_cores ) {
+			auto promise = std::make_shared<std::promise<void>>();
+			done.push_back( promise->get_future() );
+			boost::asio::post( core.io, [promise] { promise->set_value(); } );
+		}
+
+		for ( auto & f : done ) {
+			f.wait();
+		}
+	}
+
+} // namespace as
@@ -0,0 +1,149 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// fanOut.cpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#include "centrifugepp/core.hpp"
+#include "centrifugepp/logger.hpp"
+
+#include "centrifugepp/fanOut.hpp"
+
+
+namespace as {
+
+	t_subscriberId FanOut::add( const as::t_stringview channel, t_pubRoute && handler )
+	{
+		// the subscriber lists are walked by the delivering thread and changed on the io thread
+		if ( m_client.Delivery().consumers > 0 ) {
+			AS_LOG_ERROR_LINE( "FanOut needs io thread delivery (consumers = 0), " << channel << " not subscribed" );
+			return InvalidId;
+		}
+
+		auto & ch = m_channels[t_string( channel )];
+		auto id = m_nextId++;
+
+		ch.subscribers.push_back( { id, std::move( handler ) } );
+		m_subscribers.emplace( id, &ch );
+
+		if ( !ch.isRouted ) {
+			ch.name = channel;
+			ch.isRouted = true;
+
+			// a channel name, a trailing '*' does not make it a namespace prefix
+			m_client.route(
+				channel,
+				[this, &ch]( CentrifugeClientBase &,
+					t_channelId channelId,
+					const std::string_view name,
+					const SharedBuffer & data ) { deliver( ch, channelId, name, data ); },
+				true );
+		}
+
+		if ( 1 == ++ch.count ) {
+			++m_upstreamCount;
+
+			if ( m_client.IsSessionEstablished() ) {
+				m_client.subscribe( channel );
+			}
+		}
+
+		return id;
+	}
+
+
+	void FanOut::unsubscribe( t_subscriberId id )
+	{
+		auto it = m_subscribers.find( id );
+
+		if ( m_subscribers.end() == it ) {
+			return;
+		}
+
+		auto & ch = *it->second;
+		m_subscribers.erase( it );
+
+		for ( auto & s : ch.subscribers ) {
+			if ( s.id == id ) {
+				s.isRemoved = true;
+				break;
+			}
+		}
+
+		if ( 0 == ch.depth ) {
+			compact( ch );
+		}
+
+		if ( 0 == --ch.count ) {
+			--m_upstreamCount;
+
+			if ( m_client.IsSessionEstablished() ) {
+				m_client.unsubscribe( ch.name );
+			}
+		}
+	}
+
+
+	void FanOut::resubscribe()
+	{
+		for ( auto & p : m_channels ) {
+			if ( p.second.count > 0 ) {
+				m_client.subscribe( p.first );
+			}
+		}
+	}
+
+
+	/// subscribers added by a handler start with the next publication
+	void FanOut::deliver(
+		t_channel & ch, t_channelId channelId, const std::string_view name, const SharedBuffer & data )
+	{
+		++ch.depth;
+
+		try {
+			for ( size_t i = 0, n = ch.subscribers.size(); i < n; ++i ) {
+				if ( !ch.subscribers[i].isRemoved ) {
+					ch.subscribers[i].handler( m_client, channelId, name, data );
+				}
+			}
+		}
+		catch ( ... ) {
+			if ( 0 == --ch.depth ) {
+				compact( ch );
+			}
+
+			throw;
+		}
+
+		if ( 0 == --ch.depth ) {
+			compact( ch );
+		}
+	}
+
+
+	void FanOut::compact( t_channel & ch )
+	{
+		std::erase_if( ch.subscribers, []( const t_subscriber & s ) { return s.isRemoved; } );
+	}
+
+} // namespace as
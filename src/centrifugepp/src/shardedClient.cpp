@@ -0,0 +1,247 @@
+﻿/*
+ *	Copyright (c) 2025 Denis Rozhkov <denis@rozhkoff.com>
+ *	This file is part of as-centrifugepp.
+ *
+ *	as-centrifugepp is free software: you can redistribute it and/or
+ *	modify it under the terms of the GNU General Public License as published by
+ *	the Free Software Foundation, either version 3 of the License, or (at your
+ *	option) any later version.
+ *
+ *	as-centrifugepp is distributed in the hope that it will be
+ *	useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ *	Public License for more details.
+ *
+ *	You should have received a copy of the GNU General Public License along with
+ *	as-centrifugepp. If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// SPDX-FileCopyrightText: 2025 Denis Rozhkov <denis@rozhkoff.com>
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/// shardedClient.cpp
+///
+/// 0.0 - created (Denis Rozhkov <denis@rozhkoff.com>)
+///
+
+#include "centrifugepp/core.hpp"
+#include "centrifugepp/logger.hpp"
+
+#include "centrifugepp/shardedClient.hpp"
+
+
+namespace as {
+
+	ShardedClient::~ShardedClient()
+	{
+		stop();
+
+		// subscription changes still queued refer to the shards
+		m_engine.sync();
+	}
+
+
+	void ShardedClient::addShard()
+	{
+		auto & shard = *m_shards.emplace_back( std::make_unique<t_shard>() );
+		shard.core = ( m_shards.size() - 1 ) % m_engine.CoreCount();
+
+		shard.client = std::make_unique<t_shardClient>(
+			m_wsUrl,
+			m_tokenFunc,
+			[&shard]( CentrifugeClientBase & client ) {
+				for ( const auto & channel : shard.channels ) {
+					client.subscribe( channel );
+				}
+			},
+			[this, &shard]( CentrifugeClientBase & client,
+				t_channelId channelId,
+				const std::string_view channelName,
+				const SharedBuffer & data ) {
+				m_pubHandler( client, globalId( shard, channelId, channelName ), channelName, data );
+			} );
+	}
+
+
+	/// virtual nodes of a shard keep their place when shards are added or removed
+	void ShardedClient::buildRing()
+	{
+		m_ring.clear();
+
+		for ( uint32_t shard = 0; shard < m_shards.size(); ++shard ) {
+			for ( uint64_t v = 0; v < m_options.virtualNodes; ++v ) {
+				m_ring.push_back( { mix( ( uint64_t( shard ) << 32 ) | v ), shard } );
+			}
+		}
+
+		std::sort( m_ring.begin(), m_ring.end() );
+	}
+
+
+	/// runs f for channel on the io thread of shard
+	void ShardedClient::post(
+		t_shard & shard, void ( *f )( t_shard &, const t_string &, t_channelId ), const as::t_stringview channel )
+	{
+		auto id = m_ids.find( channel );
+
+		boost::asio::post( m_engine.Io( shard.core ),
+			[&shard, f, channel = t_string( channel ), id] { f( shard, channel, id ); } );
+	}
+
+
+	/// io thread of the shard
+	void ShardedClient::attach( t_shard & shard, const t_string & channel, t_channelId id )
+	{
+		shard.channels.insert( channel );
+		shard.ids[channel] = id;
+
+		if ( shard.client->IsSessionEstablished() ) {
+			shard.client->subscribe( channel );
+		}
+	}
+
+
+	/// io thread of the shard
+	void ShardedClient::detach( t_shard & shard, const t_string & channel, t_channelId )
+	{
+		shard.channels.erase( channel );
+
+		if ( shard.client->IsSessionEstablished() ) {
+			shard.client->unsubscribe( channel );
+		}
+	}
+
+
+	/// io thread of the shard, a dense array lookup once the channel has been seen
+	t_channelId ShardedClient::globalId( t_shard & shard, t_channelId localId, const std::string_view channel )
+	{
+		if ( localId >= shard.idsByLocal.size() ) {
+			shard.idsByLocal.resize( localId + 1, ChannelRegistry::InvalidId );
+		}
+
+		auto & id = shard.idsByLocal[localId];
+
+		if ( ChannelRegistry::InvalidId == id ) {
+			auto it = shard.ids.find( t_string( channel ) );
+
+			if ( it != shard.ids.end() ) {
+				id = it->second;
+			}
+		}
+
+		return id;
+	}
+
+
+	size_t ShardedClient::ShardOf( const as::t_stringview channel ) const
+	{
+		t_point point{ mix( ChannelRegistry::hash( channel ) ), 0 };
+		auto it = std::lower_bound( m_ring.begin(), m_ring.end(), point );
+
+		return ( m_ring.end() == it ? m_ring.front() : *it ).shard;
+	}
+
+
+	void ShardedClient::start()
+	{
+		m_isStarted = true;
+
+		for ( auto & shard : m_shards ) {
+			m_engine.add( *shard->client, shard->core );
+		}
+	}
+
+
+	void ShardedClient::stop()
+	{
+		m_engine.stop();
+	}
+
+
+	void ShardedClient::wait()
+	{
+		m_engine.wait();
+	}
+
+
+	void ShardedClient::subscribe( const as::t_stringview channel )
+	{
+		if ( !m_channelSet.emplace( channel ).second ) {
+			return;
+		}
+
+		m_channels.emplace_back( channel );
+		m_ids.intern( channel );
+		post( *m_shards[ShardOf( channel )], &ShardedClient::attach, channel );
+	}
+
+
+	void ShardedClient::unsubscribe( const as::t_stringview channel )
+	{
+		if ( 0 == m_channelSet.erase( t_string( channel ) ) ) {
+			return;
+		}
+
+		std::erase( m_channels, channel );
+		post( *m_shards[ShardOf( channel )], &ShardedClient::detach, channel );
+	}
+
+
+	/// a moved channel is attached on its new shard and detached from the old one by two io threads that do not wait
+	/// for each other: for a while both shards may hold it and the handler gets its publications twice, or the old
+	/// one lets go before the new subscription is confirmed and a few are missed. Removed shards are stopped and not
+	/// unsubscribed from
+	size_t ShardedClient::resize( size_t shards )
+	{
+		shards = std::max<size_t>( shards, 1 );
+
+		std::vector<t_shard *> owners;
+		owners.reserve( m_channels.size() );
+
+		for ( const auto & channel : m_channels ) {
+			owners.push_back( m_shards[ShardOf( channel )].get() );
+		}
+
+		while ( m_shards.size() < shards ) {
+			addShard();
+
+			if ( m_isStarted ) {
+				m_engine.add( *m_shards.back()->client, m_shards.back()->core );
+			}
+		}
+
+		auto retiredFrom = m_retired.size();
+
+		while ( m_shards.size() > shards ) {
+			m_shards.back()->isRetired = true;
+			m_retired.push_back( std::move( m_shards.back() ) );
+			m_shards.pop_back();
+		}
+
+		buildRing();
+
+		size_t moved = 0;
+
+		for ( size_t i = 0; i < m_channels.size(); ++i ) {
+			auto & owner = *m_shards[ShardOf( m_channels[i] )];
+
+			if ( &owner == owners[i] ) {
+				continue;
+			}
+
+			++moved;
+			post( owner, &ShardedClient::attach, m_channels[i] );
+
+			if ( !owners[i]->isRetired ) {
+				post( *owners[i], &ShardedClient::detach, m_channels[i] );
+			}
+		}
+
+		for ( auto i = retiredFrom; i < m_retired.size(); ++i ) {
+			m_retired[i]->client->stop();
+		}
+
+		return moved;
+	}
+
+} // namespace as
@@ -26,45 +26,695 @@
 
 #include "centrifugepp/core.hpp"
 #include "centrifugepp/logger.hpp"
+#include "centrifugepp/affinity.hpp"
 
 #include "centrifugepp/wsClient.hpp"
 
 
 namespace as {
 
+	namespace {
+
+		/// asio keeps its verify callback in the SSL app data, the client pointer needs a slot of its own
+		int tlsClientIndex()
+		{
+			static int index = SSL_get_ex_new_index( 0, nullptr, nullptr, nullptr, nullptr );
+			return index;
+		}
+
+
+		template <int T_level, int T_name>
+		using t_intOption = boost::asio::detail::socket_option::integer<T_level, T_name>;
+
+
+		template <typename T_option>
+		void setSocketOption( boost::asio::ip::tcp::socket & socket, const T_option & option, const char * name )
+		{
+			boost::system::error_code ec;
+			socket.set_option( option, ec );
+
+			if ( ec ) {
+				AS_LOG_WARN_LINE( "socket option " << name << ": " << ec.message() );
+			}
+		}
+
+
+		int64_t nowNs()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch() )
+				.count();
+		}
+
+
+		void cpuRelax()
+		{
+#if defined( __x86_64__ ) || defined( __i386__ )
+			__builtin_ia32_pause();
+#elif defined( __aarch64__ )
+			asm volatile( "yield" );
+#endif
+		}
+
+	} // namespace
+
+
+	void WsClientBase::resetStream()
+	{
+		if ( m_stream ) {
+			boost::system::error_code ec;
+			visitStream( [&ec]( auto & stream ) { boost::beast::get_lowest_layer( stream ).close( ec ); } );
+
+			for ( auto & socket : m_connectAttempts ) {
+				socket->close( ec );
+			}
+
+			m_connectAttemptTimer.cancel();
+			m_resolver.cancel();
+
+			// let the aborted operations of the previous stream complete before it goes away
+			do {
+				m_io.restart();
+			}
+			while ( m_io.poll() > 0 );
+
+			m_connectAttempts.clear();
+		}
+
+		m_io.restart();
+		m_ktlsSsl.reset();
+		m_isReadPaused = false;
+
+		emplaceStream();
+	}
+
+
+	void WsClientBase::emplaceStream()
+	{
+		if ( m_isTls ) {
+			m_stream.emplace( std::in_place_type<t_wssStream>, m_io, m_ctx );
+			std::get<t_wssStream>( *m_stream ).next_layer().set_verify_mode( boost::asio::ssl::verify_none );
+		}
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+		else if ( m_url.IsUnix() ) {
+			m_stream.emplace( std::in_place_type<t_wsUnixStream>, m_io );
+		}
+#endif
+		else {
+			m_stream.emplace( std::in_place_type<t_wsTcpStream>, m_io );
+		}
+
+		visitStream( [this]( auto & stream ) {
+			stream.binary( true );
+			stream.set_option( m_options.deflate );
+		} );
+
+		m_buffer.clear();
+	}
+
+
+	void WsClientBase::watchdogAsync()
+	{
+		m_watchdogTimer.expires_after( std::chrono::milliseconds( m_watchdogTimeoutMs / 2 ) );
+		m_watchdogTimer.async_wait( tracked( [this]( boost::system::error_code ec ) {
+			if ( ec || m_isStopping ) {
+				return;
+			}
+
+			if ( !m_isReadPaused && NowTs() - m_lastActivityTs > m_watchdogTimeoutMs ) {
+				stop();
+
+				return;
+			}
+
+			watchdogAsync();
+		} ) );
+	}
+
+
+	void WsClientBase::resolveAsync()
+	{
+		if ( m_url.IsUnix() ) {
+			connectUnixAsync();
+			return;
+		}
+
+		if ( ResolverCache::instance().get( m_endpointKey, m_endpoints ) ) {
+			boost::asio::post( m_io, tracked( [this] {
+				if ( !m_isStopping ) {
+					connectAsync();
+				}
+			} ) );
+
+			return;
+		}
+
+		m_resolver.async_resolve( m_url.Hostname(),
+			std::to_string( m_url.Port() ),
+			tracked( std::bind( &WsClientBase::OnResolve, this, std::placeholders::_1, std::placeholders::_2 ) ) );
+	}
+
+
+	void WsClientBase::connectUnixAsync()
+	{
+#if defined( BOOST_ASIO_HAS_LOCAL_SOCKETS )
+		std::get<t_wsUnixStream>( *m_stream )
+			.next_layer()
+			.async_connect( boost::asio::local::stream_protocol::endpoint( m_url.SocketPath() ),
+				tracked( [this]( boost::system::error_code ec ) { OnConnect( ec ); } ) );
+#else
+		boost::asio::post( m_io, tracked( [this] { OnConnect( boost::asio::error::operation_not_supported ); } ) );
+#endif
+	}
+
+
+	void WsClientBase::connectAsync( const boost::asio::ip::tcp::resolver::results_type & results )
+	{
+		m_endpoints = ResolverCache::interleave( results );
+		ResolverCache::instance().put( m_endpointKey, m_endpoints );
+
+		connectAsync();
+	}
+
+
+	/// happy eyeballs: endpoints are tried one by one, m_connectAttemptDelayMs apart or as soon as the
+	/// previous attempt fails, while earlier attempts stay pending; the first socket to connect wins
+	void WsClientBase::connectAsync()
+	{
+		++m_connectGeneration;
+		m_nextEndpoint = 0;
+		m_pendingConnectAttempts = 0;
+		m_connectAttempts.clear();
+
+		if ( m_endpoints.empty() ) {
+			OnConnect( boost::asio::error::host_not_found );
+			return;
+		}
+
+		connectNextAsync();
+	}
+
+
+	void WsClientBase::connectNextAsync()
+	{
+		auto index = m_nextEndpoint++;
+		auto generation = m_connectGeneration;
+
+		auto & socket = m_connectAttempts.emplace_back( std::make_unique<boost::asio::ip::tcp::socket>( m_io ) );
+		++m_pendingConnectAttempts;
+
+		socket->async_connect( m_endpoints[index], tracked( [this, generation, index]( boost::system::error_code ec ) {
+			OnConnectAttempt( ec, generation, index );
+		} ) );
+
+		if ( m_nextEndpoint == m_endpoints.size() ) {
+			return;
+		}
+
+		m_connectAttemptTimer.expires_after( std::chrono::milliseconds( m_connectAttemptDelayMs ) );
+		m_connectAttemptTimer.async_wait( tracked( [this, generation]( boost::system::error_code ec ) {
+			if ( ec || generation != m_connectGeneration ) {
+				return;
+			}
+
+			connectNextAsync();
+		} ) );
+	}
+
+
+	void WsClientBase::OnConnectAttempt( boost::system::error_code ec, size_t generation, size_t index )
+	{
+		if ( generation != m_connectGeneration ) {
+			return;
+		}
+
+		--m_pendingConnectAttempts;
+
+		if ( !ec ) {
+			++m_connectGeneration;
+			m_connectAttemptTimer.cancel();
+
+			boost::system::error_code closeEc;
+
+			for ( size_t i = 0; i < m_connectAttempts.size(); ++i ) {
+				if ( i != index ) {
+					m_connectAttempts[i]->close( closeEc );
+				}
+			}
+
+			visitStream( [this, index]( auto & stream ) {
+				auto & socket = boost::beast::get_lowest_layer( stream );
+
+				if constexpr ( std::is_same_v<std::decay_t<decltype( socket )>, boost::asio::ip::tcp::socket> ) {
+					socket = std::move( *m_connectAttempts[index] );
+					applySocketOptions( socket );
+				}
+			} );
+			m_connectAttempts.clear();
+
+			OnConnect( ec );
+
+			return;
+		}
+
+		if ( m_nextEndpoint < m_endpoints.size() ) {
+			m_connectAttemptTimer.cancel();
+			connectNextAsync();
+
+			return;
+		}
+
+		if ( 0 == m_pendingConnectAttempts ) {
+			++m_connectGeneration;
+			ResolverCache::instance().erase( m_endpointKey );
+
+			OnConnect( ec );
+		}
+	}
+
+
+	void WsClientBase::applySocketOptions( boost::asio::ip::tcp::socket & socket )
+	{
+		const auto & o = m_options.socket;
+
+		setSocketOption( socket, boost::asio::ip::tcp::no_delay( o.isNoDelay ), "TCP_NODELAY" );
+
+		if ( o.receiveBufferSize > 0 ) {
+			setSocketOption(
+				socket, boost::asio::socket_base::receive_buffer_size( o.receiveBufferSize ), "SO_RCVBUF" );
+		}
+
+		if ( o.sendBufferSize > 0 ) {
+			setSocketOption( socket, boost::asio::socket_base::send_buffer_size( o.sendBufferSize ), "SO_SNDBUF" );
+		}
+
+#if defined( SO_BUSY_POLL )
+		if ( o.busyPollUs > 0 ) {
+			setSocketOption( socket, t_intOption<SOL_SOCKET, SO_BUSY_POLL>( o.busyPollUs ), "SO_BUSY_POLL" );
+		}
+#endif
+
+		if ( o.keepAliveIdleS > 0 ) {
+			setSocketOption( socket, boost::asio::socket_base::keep_alive( true ), "SO_KEEPALIVE" );
+
+#if defined( TCP_KEEPIDLE )
+			setSocketOption( socket, t_intOption<IPPROTO_TCP, TCP_KEEPIDLE>( o.keepAliveIdleS ), "TCP_KEEPIDLE" );
+#endif
+
+#if defined( TCP_KEEPINTVL )
+			if ( o.keepAliveIntervalS > 0 ) {
+				setSocketOption(
+					socket, t_intOption<IPPROTO_TCP, TCP_KEEPINTVL>( o.keepAliveIntervalS ), "TCP_KEEPINTVL" );
+			}
+#endif
+
+#if defined( TCP_KEEPCNT )
+			if ( o.keepAliveCount > 0 ) {
+				setSocketOption( socket, t_intOption<IPPROTO_TCP, TCP_KEEPCNT>( o.keepAliveCount ), "TCP_KEEPCNT" );
+			}
+#endif
+		}
+
+#if defined( TCP_USER_TIMEOUT )
+		if ( o.userTimeoutMs > 0 ) {
+			setSocketOption( socket,
+				t_intOption<IPPROTO_TCP, TCP_USER_TIMEOUT>( static_cast<int>( o.userTimeoutMs ) ),
+				"TCP_USER_TIMEOUT" );
+		}
+#endif
+
+		rearmQuickAck();
+	}
+
+
+	void WsClientBase::rearmQuickAck()
+	{
+#if defined( TCP_QUICKACK )
+		if ( !m_options.socket.isQuickAck ) {
+			return;
+		}
+
+		visitStream( []( auto & stream ) {
+			auto & socket = boost::beast::get_lowest_layer( stream );
+
+			if constexpr ( std::is_same_v<std::decay_t<decltype( socket )>, boost::asio::ip::tcp::socket> ) {
+				setSocketOption( socket, t_intOption<IPPROTO_TCP, TCP_QUICKACK>( 1 ), "TCP_QUICKACK" );
+			}
+		} );
+#endif
+	}
+
+
+	void WsClientBase::offerTlsSession()
+	{
+		auto ssl = tlsHandle();
+		SSL_set_ex_data( ssl, tlsClientIndex(), this );
+
+		if ( m_isTlsSessionResumption ) {
+			TlsSessionCache::instance().apply( m_endpointKey, ssl );
+		}
+	}
+
+
+	void WsClientBase::countTlsHandshake( bool isSuccessful )
+	{
+		if ( !isSuccessful ) {
+			// the offered session may be the reason, do not offer it again
+			TlsSessionCache::instance().erase( m_endpointKey );
+			return;
+		}
+
+		++m_tlsHandshakeCount;
+
+		if ( SSL_session_reused( tlsHandle() ) ) {
+			++m_tlsResumedCount;
+		}
+	}
+
+
+	bool WsClientBase::isKtlsEnabled() const
+	{
+#if defined( AS_HAS_KTLS )
+		return m_isTls && m_options.isKtls && !m_isKtlsFailed;
+#else
+		return false;
+#endif
+	}
+
+
+	/// asio drives OpenSSL through a memory BIO pair, which kTLS cannot be enabled on; the handshake runs on a
+	/// socket BIO over the connected socket instead, and once the kernel holds the keys of both directions the
+	/// websocket goes on as plain ws over that socket
+	void WsClientBase::ktlsHandshakeAsync()
+	{
+#if defined( AS_HAS_KTLS )
+		auto & socket = boost::beast::get_lowest_layer( std::get<t_wssStream>( *m_stream ) );
+
+		boost::system::error_code ec;
+		socket.non_blocking( true, ec );
+
+		m_ktlsSsl.reset( SSL_new( m_ctx.native_handle() ) );
+
+		if ( ec || !m_ktlsSsl || SSL_set_fd( m_ktlsSsl.get(), static_cast<int>( socket.native_handle() ) ) != 1 ) {
+			m_ktlsSsl.reset();
+			OnSslHandshake( ec ? ec : boost::asio::error::no_memory );
+			return;
+		}
+
+		// TLS 1.3 sends session tickets and key updates after the handshake, which the kernel hands to read() as
+		// EIO; TLS 1.2 tickets come within the handshake, resumption keeps working
+		SSL_set_options( m_ktlsSsl.get(), SSL_OP_ENABLE_KTLS );
+		SSL_set_max_proto_version( m_ktlsSsl.get(), TLS1_2_VERSION );
+		SSL_set_connect_state( m_ktlsSsl.get() );
+		SSL_set_tlsext_host_name( m_ktlsSsl.get(), m_url.Hostname().c_str() );
+		offerTlsSession();
+
+		ktlsHandshakeStep();
+#endif
+	}
+
+
+	void WsClientBase::ktlsHandshakeStep()
+	{
+#if defined( AS_HAS_KTLS )
+		auto ssl = m_ktlsSsl.get();
+		auto & socket = boost::beast::get_lowest_layer( std::get<t_wssStream>( *m_stream ) );
+
+		ERR_clear_error();
+		auto r = SSL_do_handshake( ssl );
+
+		if ( r != 1 ) {
+			auto e = SSL_get_error( ssl, r );
+
+			if ( SSL_ERROR_WANT_READ == e || SSL_ERROR_WANT_WRITE == e ) {
+				socket.async_wait( SSL_ERROR_WANT_READ == e ? boost::asio::ip::tcp::socket::wait_read
+															: boost::asio::ip::tcp::socket::wait_write,
+					tracked( [this]( boost::system::error_code ec ) {
+						if ( ec ) {
+							OnSslHandshake( ec );
+							return;
+						}
+
+						ktlsHandshakeStep();
+					} ) );
+
+				return;
+			}
+
+			auto err = ERR_get_error();
+			OnSslHandshake( 0 == err
+					? boost::system::error_code( boost::asio::ssl::error::stream_truncated )
+					: boost::system::error_code( static_cast<int>( err ), boost::asio::error::get_ssl_category() ) );
+
+			return;
+		}
+
+		if ( !BIO_get_ktls_send( SSL_get_wbio( ssl ) ) || !BIO_get_ktls_recv( SSL_get_rbio( ssl ) )
+			|| SSL_pending( ssl ) > 0 ) {
+
+			// the kernel module, the OpenSSL build or the negotiated cipher do not allow it; this connection is made
+			// again and the following ones of this client are made over userspace TLS
+			AS_LOG_WARN_LINE( "kTLS is not available, falling back to userspace TLS" );
+
+			m_isKtlsFailed = true;
+
+			boost::system::error_code ec;
+			socket.close( ec );
+			m_ktlsSsl.reset();
+
+			emplaceStream();
+			connectAsync();
+
+			return;
+		}
+
+		boost::asio::ip::tcp::socket plain( std::move( socket ) );
+		m_stream.emplace( std::in_place_type<t_wsTcpStream>, std::move( plain ) );
+
+		visitStream( [this]( auto & stream ) {
+			stream.binary( true );
+			stream.set_option( m_options.deflate );
+		} );
+
+		OnSslHandshake( {} );
+#endif
+	}
+
+
+	int WsClientBase::OnNewTlsSession( SSL * ssl, SSL_SESSION * session )
+	{
+		auto client = static_cast<WsClientBase *>( SSL_get_ex_data( ssl, tlsClientIndex() ) );
+
+		if ( client != nullptr && client->m_isTlsSessionResumption && SSL_SESSION_is_resumable( session ) ) {
+			TlsSessionCache::instance().put( client->m_endpointKey, session );
+		}
+
+		// the cache keeps a copy, the reference stays with OpenSSL
+		return 0;
+	}
+
+
+	/// own io context only, returns once the connection is down
 	void WsClientBase::run()
 	{
-		m_stream.next_layer().set_verify_mode( boost::asio::ssl::verify_none );
+		resetStream();
+		m_isStopping = false;
 
-		boost::asio::ip::tcp::resolver resolver( m_io );
-		std::string portS = std::to_string( m_url.Port() );
-		resolver.async_resolve( m_url.Hostname(),
-			portS,
-			std::bind( &WsClientBase::OnResolve, this, std::placeholders::_1, std::placeholders::_2 ) );
+		resolveAsync();
 
 		refreshLastActivityTs();
-		m_isWatchdogActive.test_and_set();
+		watchdogAsync();
+
+		if ( m_options.run.cpu >= 0 && !pinThread( m_options.run.cpu ) ) {
+			AS_LOG_WARN_LINE( m_id << " cannot pin to cpu " << m_options.run.cpu );
+		}
+
+		if ( t_runMode::Spin == m_options.run.mode ) {
+			spin();
+		}
+		else {
+			m_io.run();
+		}
+
+		m_watchdogTimer.cancel();
+		m_deferTimer.cancel();
+	}
+
+
+	/// polls until the io context runs out of work or is stopped; the clock is read once per poll
+	void WsClientBase::spin()
+	{
+		const auto idleNs = m_options.run.idleUs * 1000;
 
-		m_watchdogThread = std::thread( [this] {
-			while ( m_isWatchdogActive.test_and_set() ) {
-				std::this_thread::sleep_for( std::chrono::milliseconds( m_watchdogTimeoutMs / 2 ) );
+		size_t polls = m_pollCount;
+		size_t idlePolls = m_idlePollCount;
+		int64_t workNs = m_workNs;
+		int64_t spinNs = m_spinNs;
+		int64_t sleepNs = m_sleepNs;
 
-				if ( NowTs() - m_lastActivityTs > m_watchdogTimeoutMs ) {
-					m_io.stop();
+		auto ts = nowNs();
+		auto workTs = ts;
 
-					return;
+		while ( !m_io.stopped() ) {
+			auto n = m_io.poll();
+			++polls;
+
+			if ( 0 == n ) {
+				++idlePolls;
+
+				for ( size_t i = 0; i < m_options.run.pauseCount; ++i ) {
+					cpuRelax();
 				}
 			}
-		} );
 
-		m_io.run();
+			auto now = nowNs();
+
+			if ( n > 0 ) {
+				workNs += now - ts;
+				workTs = now;
+			}
+			else {
+				spinNs += now - ts;
+
+				if ( idleNs > 0 && now - workTs >= idleNs ) {
+					m_io.run_one();
+
+					ts = now;
+					now = nowNs();
+					sleepNs += now - ts;
+					workTs = now;
+				}
+			}
+
+			ts = now;
+
+			m_pollCount.store( polls, std::memory_order_relaxed );
+			m_idlePollCount.store( idlePolls, std::memory_order_relaxed );
+			m_workNs.store( workNs, std::memory_order_relaxed );
+			m_spinNs.store( spinNs, std::memory_order_relaxed );
+			m_sleepNs.store( sleepNs, std::memory_order_relaxed );
+		}
+	}
+
+
+	/// shared io context only, any thread: connects and returns; stoppedHandler runs on the io thread once the
+	/// connection is down and everything it started has completed, the next start() may follow from there
+	void WsClientBase::start( std::function<void()> && stoppedHandler )
+	{
+		m_isStopping = false;
+
+		boost::asio::post( m_io, tracked( [this, handler = std::move( stoppedHandler )]() mutable {
+			m_stoppedHandler = std::move( handler );
+			m_connectAttempts.clear();
+			m_ktlsSsl.reset();
+			m_isReadPaused = false;
+
+			emplaceStream();
+
+			resolveAsync();
+
+			refreshLastActivityTs();
+			watchdogAsync();
+
+			// stopped before it got here
+			if ( m_isStopping ) {
+				shutdown();
+			}
+		} ) );
+	}
+
+
+	/// any thread
+	void WsClientBase::stop()
+	{
+		m_isStopping = true;
+
+		if ( m_ownIo ) {
+			m_io.stop();
+			return;
+		}
+
+		boost::asio::post( m_io, tracked( [this] { shutdown(); } ) );
+	}
+
+
+	/// shared io context: aborts everything the connection has pending
+	void WsClientBase::shutdown()
+	{
+		if ( !m_stoppedHandler ) {
+			return;
+		}
+
+		m_isStopping = true;
+		++m_connectGeneration;
+
+		boost::system::error_code ec;
+
+		if ( m_stream ) {
+			visitStream( [&ec]( auto & stream ) { boost::beast::get_lowest_layer( stream ).close( ec ); } );
+		}
+
+		for ( auto & socket : m_connectAttempts ) {
+			socket->close( ec );
+		}
+
+		m_resolver.cancel();
+		m_connectAttemptTimer.cancel();
+		m_watchdogTimer.cancel();
+		m_deferTimer.cancel();
+	}
+
+
+	void WsClientBase::completeStop()
+	{
+		if ( m_ownIo || !m_isStopping || m_pendingOps > 0 || !m_stoppedHandler ) {
+			return;
+		}
+
+		m_connectAttempts.clear();
+
+		auto handler = std::move( m_stoppedHandler );
+		m_stoppedHandler = nullptr;
+
+		handler();
 	}
 
 
 	void WsClientBase::readAsync()
 	{
-		m_stream.async_read(
-			m_buffer, std::bind( &WsClientBase::OnReadComplete, this, std::placeholders::_1, std::placeholders::_2 ) );
+		rearmQuickAck();
+
+		visitStream( [this]( auto & stream ) {
+			stream.async_read( m_buffer,
+				tracked( std::bind(
+					&WsClientBase::OnReadComplete, this, std::placeholders::_1, std::placeholders::_2 ) ) );
+		} );
+	}
+
+
+	/// any thread, the read is re-armed on the io thread
+	void WsClientBase::resumeRead()
+	{
+		boost::asio::post( m_io, tracked( [this] {
+			if ( m_isStopping || !m_isReadPaused.exchange( false ) ) {
+				return;
+			}
+
+			refreshLastActivityTs();
+			readAsync();
+		} ) );
+	}
+
+
+	/// io thread only: handler runs once after us, unless deferred again before or the connection is dropped
+	void WsClientBase::deferAsync( t_timespan us, std::function<void()> && handler )
+	{
+		m_deferTimer.expires_after( std::chrono::microseconds( us ) );
+		m_deferTimer.async_wait( tracked( [handler = std::move( handler )]( boost::system::error_code ec ) {
+			if ( !ec ) {
+				handler();
+			}
+		} ) );
 	}
 
 
@@ -73,7 +723,7 @@ namespace as {
 		std::lock_guard<std::mutex> lock( m_streamWriteSync );
 
 		boost::system::error_code ec;
-		m_stream.write( boost::asio::buffer( data, size ), ec );
+		visitStream( [&]( auto & stream ) { stream.write( boost::asio::buffer( data, size ), ec ); } );
 
 		return static_cast<bool>( ec );
 	}
@@ -83,8 +733,11 @@ namespace as {
 	{
 		std::lock_guard<std::mutex> lock( m_streamWriteSync );
 
-		m_stream.async_write( boost::asio::buffer( data, size ),
-			std::bind( &WsClientBase::OnWriteComplete, this, std::placeholders::_1, std::placeholders::_2 ) );
+		visitStream( [&]( auto & stream ) {
+			stream.async_write( boost::asio::buffer( data, size ),
+				tracked( std::bind(
+					&WsClientBase::OnWriteComplete, this, std::placeholders::_1, std::placeholders::_2 ) ) );
+		} );
 	}
 
 
@@ -92,8 +745,10 @@ namespace as {
 	{
 		std::lock_guard<std::mutex> lock( m_streamPingSync );
 
-		m_stream.async_ping( { static_cast<const char *>( data ), size },
-			std::bind( &WsClientBase::OnPingComplete, this, std::placeholders::_1 ) );
+		visitStream( [&]( auto & stream ) {
+			stream.async_ping( { static_cast<const char *>( data ), size },
+				tracked( std::bind( &WsClientBase::OnPingComplete, this, std::placeholders::_1 ) ) );
+		} );
 	}
 
 } // namespace as